@@ -0,0 +1,118 @@
+/*
+IVFORMAT.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVFormat.hpp"
+
+#include <cstring>		//memcmp
+#include <cstdio>		//fopen
+
+/* Checked in order, the extension's format first */
+static constexpr IVFORMAT::format FORMATS[] = {
+	{"JPEG", IVUTIL::JPG, IVUTIL::TYPE_SDL, IVFORMAT::CAN_SCALE | IVFORMAT::HAS_THUMBNAIL,
+		{"JPG", "JPEG", "JFIF"},
+		{{0, 3, "\xFF\xD8\xFF"}}},
+	{"PNG", IVUTIL::PNG, IVUTIL::TYPE_SDL, 0,
+		{"PNG"},
+		{{0, 8, "\x89PNG\r\n\x1A\n"}}},
+	{"GIF", IVUTIL::GIF, IVUTIL::TYPE_GIFLIB, IVFORMAT::CAN_ANIMATE,
+		{"GIF"},
+		{{0, 6, "GIF87a"}, {0, 6, "GIF89a"}}},
+	{"BMP", IVUTIL::BMP, IVUTIL::TYPE_SDL, 0,
+		{"BMP", "DIB"},
+		{{0, 2, "BM"}}},
+	{"TIFF", IVUTIL::TIF, IVUTIL::TYPE_SDL, 0,
+		{"TIF", "TIFF"},
+		{{0, 4, "II*\0"}, {0, 4, "MM\0*"}}},
+	{"HEIF", IVUTIL::HEIF, IVUTIL::TYPE_LIBHEIF, IVFORMAT::CAN_TILE | IVFORMAT::HAS_THUMBNAIL,
+		{"HEIC", "HEIF"},
+		{{4, 8, "ftypheic"}, {4, 8, "ftypheix"}, {4, 8, "ftyphevc"}, {4, 8, "ftyphevx"},
+		 {4, 8, "ftypheim"}, {4, 8, "ftypheis"}, {4, 8, "ftypmif1"}, {4, 8, "ftypmsf1"}}},
+	// TGA has no magic number at the start, so it's only ever known by extension
+	{"TGA", IVUTIL::TGA, IVUTIL::TYPE_SDL, 0,
+		{"TGA"},
+		{}},
+};
+
+/**
+* extensionIs	- Case insensitive comparison of a file extension with a registered one
+* extension 	> File extension, with its leading dot
+* candidate 	> Registered extension, upper case without the dot
+*/
+static bool extensionIs(const std::string& extension, const char* candidate) {
+	if (extension.size() < 2 || extension.size() - 1 != std::strlen(candidate)) return false;
+	for (size_t i = 1; i < extension.size(); i++) {
+		char c = extension[i];
+		if (c > 0x60 && c < 0x7B) c -= 0x20;
+		if (c != candidate[i - 1]) return false;
+	}
+	return true;
+}
+
+/**
+* matches 		- Check a file header against a format's magic numbers
+* f 			> Format to test
+* head 			> First bytes of the file
+* length 		> Number of bytes in head
+* return - bool	< True if any of the format's signatures match
+*/
+static bool matches(const IVFORMAT::format& f, const uint8_t* head, size_t length) {
+	for (const IVFORMAT::signature& s : f.magic) {
+		if (!s.length) break;
+		if ((size_t) s.offset + s.length <= length && !std::memcmp(head + s.offset, s.bytes, s.length)) return true;
+	}
+	return false;
+}
+
+/**
+* detect 		- Identify a file from its first bytes
+* head 			> First bytes of the file, ideally FORMAT_SNIFF_BYTES of them
+* length 		> Number of bytes in head
+* extension 	> File extension with its leading dot, tried first and used for formats without a magic number
+* return - ptr 	< Registered format or nullptr if unsupported
+*/
+const IVFORMAT::format* IVFORMAT::detect(const uint8_t* head, size_t length, const std::string& extension) {
+	const format* hint = guess(extension);
+	if (hint && matches(*hint, head, length)) return hint;
+
+	// misnamed, go by content alone
+	for (const format& f : FORMATS) {
+		if (&f != hint && matches(f, head, length)) return &f;
+	}
+
+	if (hint && !hint->magic[0].length) return hint;
+	return nullptr;
+}
+
+/**
+* detect 		- Read the start of a file and identify it
+* path 			> Path to the file
+* return - ptr 	< Registered format or nullptr if unsupported or unreadable
+*/
+const IVFORMAT::format* IVFORMAT::detect(std::filesystem::path path) {
+	uint8_t head[FORMAT_SNIFF_BYTES];
+	size_t length = 0;
+
+	FILE* file = fopen(path.string().c_str(), "rb");
+	if (!file) return nullptr;
+	length = fread(head, 1, sizeof(head), file);
+	fclose(file);
+
+	return detect(head, length, path.extension().string());
+}
+
+/**
+* guess 		- Format an extension suggests, without reading the file
+* extension 	> File extension with its leading dot
+* return - ptr 	< Registered format or nullptr if the extension is unknown
+*/
+const IVFORMAT::format* IVFORMAT::guess(const std::string& extension) {
+	for (const format& f : FORMATS) {
+		for (const char* e : f.extensions) {
+			if (e && extensionIs(extension, e)) return &f;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,52 @@
+/*
+IVFORMAT.HPP
+NICK WILSON
+2020
+*/
+
+#include <cstdint>		//standard number formats
+#include <string>		//string type
+#include <filesystem>	//fs path
+
+#include "IVUtil.hpp"	//FILE_TYPE, LIB_TYPE_SUPPORT
+
+#ifndef IVFORMAT_H
+#define IVFORMAT_H
+
+#define FORMAT_SNIFF_BYTES 32	// enough of the file header to identify every registered format
+
+/* Registry of supported formats, identified by the magic numbers at the start of a file. Extensions are only a hint */
+namespace IVFORMAT {
+	enum capability : uint32_t {
+		CAN_ANIMATE		= 1 << 0,	// may hold several timed frames
+		CAN_TILE		= 1 << 1,	// stored in independently decodable tiles
+		CAN_SCALE		= 1 << 2,	// can be decoded straight to a reduced size
+		HAS_THUMBNAIL	= 1 << 3,	// may carry a small embedded preview
+	};
+
+	struct signature {
+		uint8_t offset;
+		uint8_t length;		// 0 marks an unused slot
+		const char* bytes;
+	};
+
+	struct format {
+		const char* name;
+		IVUTIL::FILE_TYPE type;
+		IVUTIL::LIB_TYPE_SUPPORT library;
+		uint32_t capabilities;
+		const char* extensions[3];	// upper case, without the dot, nullptr if unused
+		signature magic[8];			// any one matching identifies the format, none at all means extension only
+	};
+
+	/* Identify a file from its first bytes, trying the format its extension suggests first. nullptr if unsupported */
+	const format* detect(const uint8_t* head, size_t length, const std::string& extension);
+
+	/* Read the start of a file and identify it. nullptr if unsupported or unreadable */
+	const format* detect(std::filesystem::path path);
+
+	/* Format an extension suggests, without reading the file. For filtering folders, where opening every file costs too much */
+	const format* guess(const std::string& extension);
+}
+
+#endif
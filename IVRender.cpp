@@ -0,0 +1,224 @@
+/*
+IVRENDER.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVRender.hpp"
+
+#include <cstring>		//memcpy
+#include <algorithm>	//min, max
+#include <cmath>		//floor, ceil
+
+/**
+* nativeFormat		- The renderer's preferred 32 BPP format with alpha, which its textures hold without any conversion
+* renderer 			> Target SDL_Renderer
+* return - uint32_t	< SDL_PixelFormatEnum, SDL_PIXELFORMAT_ARGB8888 if the renderer doesn't list one
+*/
+uint32_t IVRENDER::nativeFormat(SDL_Renderer* renderer) {
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer, &info)) return SDL_PIXELFORMAT_ARGB8888;
+
+	// listed best first
+	for (uint32_t i = 0; i < info.num_texture_formats; i++) {
+		uint32_t format = info.texture_formats[i];
+		if (!SDL_ISPIXELFORMAT_FOURCC(format) && SDL_BITSPERPIXEL(format) == 32 && SDL_ISPIXELFORMAT_ALPHA(format)) return format;
+	}
+	return SDL_PIXELFORMAT_ARGB8888;
+}
+
+/**
+* textureFormats 					- Every 32 BPP format the renderer's textures hold without any conversion
+* renderer 							> Target SDL_Renderer
+* return - std::vector<uint32_t>	< SDL_PixelFormatEnums, empty if the renderer doesn't list any
+*/
+std::vector<uint32_t> IVRENDER::textureFormats(SDL_Renderer* renderer) {
+	std::vector<uint32_t> formats;
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(renderer, &info)) return formats;
+
+	for (uint32_t i = 0; i < info.num_texture_formats; i++) {
+		uint32_t format = info.texture_formats[i];
+		if (!SDL_ISPIXELFORMAT_FOURCC(format) && SDL_BITSPERPIXEL(format) == 32) formats.push_back(format);
+	}
+	return formats;
+}
+
+/**
+* createTexture			- Copy a surface into a new texture of the same format, so the renderer has nothing to convert.
+*						  Blend mode is set to none, callers drawing transparent images change it.
+* renderer 				> Target SDL_Renderer
+* surface 				> Pixels to copy, ideally already in nativeFormat()
+* access 				> SDL_TEXTUREACCESS_STREAMING to write through a lock, SDL_TEXTUREACCESS_STATIC for textures that never change
+* return - SDL_Texture*	< New texture, nullptr on failure
+*/
+SDL_Texture* IVRENDER::createTexture(SDL_Renderer* renderer, SDL_Surface* surface, int access) {
+	SDL_Texture* texture = SDL_CreateTexture(renderer, surface->format->format, access, surface->w, surface->h);
+	if (!texture) {
+		// a format the renderer can't hold at all, let SDL pick and convert
+		texture = SDL_CreateTextureFromSurface(renderer, surface);
+		if (texture) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+		return texture;
+	}
+	// SDL blends any format with alpha by default
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+
+	void* pixels;
+	int pitch;
+	if (access == SDL_TEXTUREACCESS_STREAMING && !SDL_LockTexture(texture, nullptr, &pixels, &pitch)) {
+		size_t row = std::min((size_t) surface->w * surface->format->BytesPerPixel, (size_t) pitch);
+		for (int y = 0; y < surface->h; y++) {
+			memcpy((uint8_t*) pixels + (size_t) y * pitch, (uint8_t*) surface->pixels + (size_t) y * surface->pitch, row);
+		}
+		SDL_UnlockTexture(texture);
+	}
+	else {
+		SDL_UpdateTexture(texture, nullptr, surface->pixels, surface->pitch);
+	}
+	return texture;
+}
+
+/**
+* copyClipped 	- Draw a texture stretched over destination, handing the renderer only the part of it that lands in viewport.
+*				  Zoomed in, destination can be hundreds of thousands of pixels across, and the renderer would otherwise
+*				  work out (and the software one walk) all of it. Float placement keeps the cut edges exactly where they were.
+* renderer 		> Target SDL_Renderer
+* texture 		> Texture to draw, the whole of it fills destination
+* destination 	> Where the whole texture would be drawn, may extend well past the viewport
+* viewport 		> Visible area of the window
+*/
+void IVRENDER::copyClipped(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* destination, const SDL_Rect* viewport) {
+	SDL_Rect visible;
+	int tw, th;
+	if (!texture || !SDL_IntersectRect(destination, viewport, &visible)) return;
+	if (SDL_QueryTexture(texture, nullptr, nullptr, &tw, &th) || tw <= 0 || th <= 0) return;
+
+	// texture pixels per window pixel
+	double sx = (double) tw / destination->w;
+	double sy = (double) th / destination->h;
+
+	// texels under the visible area, plus one either side so linear filtering has its neighbours at the window edges
+	int x0 = std::max(0, (int) std::floor((visible.x - destination->x) * sx) - 1);
+	int y0 = std::max(0, (int) std::floor((visible.y - destination->y) * sy) - 1);
+	int x1 = std::min(tw, (int) std::ceil((visible.x + visible.w - destination->x) * sx) + 1);
+	int y1 = std::min(th, (int) std::ceil((visible.y + visible.h - destination->y) * sy) + 1);
+
+	if (x0 == 0 && y0 == 0 && x1 == tw && y1 == th) {
+		SDL_RenderCopy(renderer, texture, nullptr, destination);
+		return;
+	}
+	SDL_Rect source = {x0, y0, x1 - x0, y1 - y0};
+
+	// where those texels would have landed anyway, which is near the viewport so even a float holds it precisely
+	double dx = destination->x + x0 / sx;
+	double dy = destination->y + y0 / sy;
+	double dw = source.w / sx;
+	double dh = source.h / sy;
+
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+	SDL_FRect placed = {(float) dx, (float) dy, (float) dw, (float) dh};
+	SDL_RenderCopyF(renderer, texture, &source, &placed);
+#else
+	// whole pixels only, so compute both edges and let neighbouring draws meet without gaps
+	int left = (int) std::floor(dx), top = (int) std::floor(dy);
+	SDL_Rect placed = {left, top, (int) std::floor(dx + dw) - left, (int) std::floor(dy + dh) - top};
+	SDL_RenderCopy(renderer, texture, &source, &placed);
+#endif
+}
+
+/**
+* placeImage		- Where an image goes in the window, respecting zoom and pan positioning
+* win 				> Target Window object
+* image 			> Image to place
+* zoom 				> Scale relative to fitting the window
+* offsetX 			> Horizontal pan in pixels
+* offsetY 			> Vertical pan in pixels
+* return - SDL_Rect	< Area covered by the whole image, which may extend past the window
+*/
+SDL_Rect IVRENDER::placeImage(Window* win, IVImage* image, float zoom, int offsetX, int offsetY) {
+	//image is too big for the window
+	if (image->h > win->h || image->w > win->w) {
+		//determine the shapes of window and image
+		float imageAspectRatio = image->w/(float) image->h;
+		float windowAspectRatio = win->w/(float) win->h;
+
+		//width is priority
+		if (imageAspectRatio > windowAspectRatio) {
+			//figure out how image will be scaled to fit
+			float imageReduction = win->w/(float) image->w;
+			//apply transformation to height
+			int imageTargetHeight = imageReduction * image->h;
+
+			//horizontal adjustment
+			int xPos = (win->w - win->w * zoom)/2 + offsetX;
+			//vertical adjustment
+			int yPos = (win->h - imageTargetHeight * zoom)/2 + offsetY;
+
+			return {xPos, yPos, (int) (win->w * zoom), (int) (imageTargetHeight * zoom)};
+		}
+		//height is priority or equal priority
+		else {
+			//figure out how image will be scaled to fit
+			float imageReduction = win->h/(float) image->h;
+			//apply transformation to width
+			int imageTargetWidth = imageReduction * image->w;
+
+			//horizontal adjustment
+			int xPos = (win->w - imageTargetWidth * zoom)/2 + offsetX;
+			//vertical adjustment
+			int yPos = (win->h - win->h * zoom)/2 + offsetY;
+
+			return {xPos, yPos, (int) (imageTargetWidth * zoom), (int) (win->h * zoom)};
+		}
+	}
+	//image will fit in existing window
+	else {
+		int xPos = (win->w - image->w * zoom)/2 + offsetX;
+		int yPos = (win->h - image->h * zoom)/2 + offsetY;
+		return {xPos, yPos, (int) (image->w * zoom), (int) (image->h * zoom)};
+	}
+}
+
+/**
+* drawImage	- Render the display image, respecting zoom and pan positioning
+* win 		> Target Window object
+* image 	> Image to draw
+* zoom 		> Scale relative to fitting the window
+* offsetX 	> Horizontal pan in pixels
+* offsetY 	> Vertical pan in pixels
+*/
+void IVRENDER::drawImage(Window* win, IVImage* image, float zoom, int offsetX, int offsetY) {
+	//only the window area needs to be drawn, which matters for tiled images
+	SDL_Rect viewport = {0, 0, win->w, win->h};
+	SDL_Rect windowDestination = placeImage(win, image, zoom, offsetX, offsetY);
+	image->draw(&windowDestination, &viewport);
+}
+
+/**
+* drawTileTexture	- Draw the checkerboard across the window, leaving out the area an opaque image will cover
+* win 				> Target Window object
+* tiledTexture 		> Checkerboard to draw
+* hole 				> Area that will be completely covered anyway, nullptr to fill the whole window
+*/
+void IVRENDER::drawTileTexture(Window* win, TiledTexture* tiledTexture, const SDL_Rect* hole) {
+	SDL_Texture* layer = tiledTexture->layer(win->w, win->h);
+	if (!layer) return;
+
+	SDL_Rect window = {0, 0, win->w, win->h};
+	SDL_Rect covered;
+	if (!hole || !SDL_IntersectRect(hole, &window, &covered)) {
+		SDL_RenderCopy(win->renderer, layer, nullptr, nullptr);
+		return;
+	}
+
+	// the layer is window sized, so each piece is copied to where it came from
+	SDL_Rect pieces[4] = {
+		{0, 0, win->w, covered.y},
+		{0, covered.y + covered.h, win->w, win->h - (covered.y + covered.h)},
+		{0, covered.y, covered.x, covered.h},
+		{covered.x + covered.w, covered.y, win->w - (covered.x + covered.w), covered.h},
+	};
+	for (SDL_Rect& piece : pieces) {
+		if (piece.w > 0 && piece.h > 0) SDL_RenderCopy(win->renderer, layer, &piece, &piece);
+	}
+}
@@ -0,0 +1,35 @@
+/*
+IVRENDER.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <vector>		//texture formats
+
+#include "subclasses/Window.hpp"
+#include "subclasses/TiledTexture.hpp"
+#include "subclasses/IVImage.hpp"
+
+#ifndef IVRENDER_H
+#define IVRENDER_H
+
+/* Drawing shared by the viewer and the benchmark. Nothing here depends on the platform. */
+namespace IVRENDER {
+	uint32_t nativeFormat(SDL_Renderer* renderer);
+
+	std::vector<uint32_t> textureFormats(SDL_Renderer* renderer);
+
+	SDL_Texture* createTexture(SDL_Renderer* renderer, SDL_Surface* surface, int access);
+
+	void copyClipped(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* destination, const SDL_Rect* viewport);
+
+	SDL_Rect placeImage(Window* win, IVImage* image, float zoom, int offsetX, int offsetY);
+
+	void drawImage(Window* win, IVImage* image, float zoom, int offsetX, int offsetY);
+
+	void drawTileTexture(Window* win, TiledTexture* tiledTexture, const SDL_Rect* hole = nullptr);
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+IVSCALE.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVScale.hpp"
+
+#include <algorithm>	//min, max
+#include <vector>		//threads
+#include <thread>		//row bands
+
+#ifdef __SSE2__
+#include <emmintrin.h>	//SSE2, always there on x86-64
+#endif
+
+/**
+* halveRows - Average 2x2 blocks of source into rows first to last of target. Odd trailing rows and columns are clamped to the edge.
+* source 	> 32 BPP surface
+* target 	< Surface half the size in the same format
+* first 	> First output row
+* last 		> One past the last output row
+*/
+static void halveRows(SDL_Surface* source, SDL_Surface* target, int first, int last) {
+	for (int y = first; y < last; y++) {
+		const uint8_t* row0 = (const uint8_t*) source->pixels + (size_t) std::min(y * 2, source->h - 1) * source->pitch;
+		const uint8_t* row1 = (const uint8_t*) source->pixels + (size_t) std::min(y * 2 + 1, source->h - 1) * source->pitch;
+		uint8_t* out = (uint8_t*) target->pixels + (size_t) y * target->pitch;
+		int x = 0;
+
+#ifdef __SSE2__
+		// four source pixels from each row make two output pixels, summed in 16 bits so the rounding matches the scalar code
+		if (source->w > 1) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i two = _mm_set1_epi16(2);
+			for (; x + 2 <= target->w; x += 2) {
+				__m128i top = _mm_loadu_si128((const __m128i*) (row0 + x * 8));
+				__m128i bottom = _mm_loadu_si128((const __m128i*) (row1 + x * 8));
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+				low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+				high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+				__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), two), 2);
+				_mm_storel_epi64((__m128i*) (out + x * 4), _mm_packus_epi16(sum, zero));
+			}
+		}
+#endif
+
+		for (; x < target->w; x++) {
+			int x0 = std::min(x * 2, source->w - 1) * 4;
+			int x1 = std::min(x * 2 + 1, source->w - 1) * 4;
+			for (int c = 0; c < 4; c++) {
+				out[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+			}
+		}
+	}
+}
+
+/**
+* halve 				- Halve a 32 BPP surface with a 2x2 area average. Rows are split into bands across every core.
+* source 				> Surface to shrink, left untouched
+* return - SDL_Surface*	< New surface of half the size (at least 1x1) in the same format, nullptr if source isn't 32 BPP or allocation failed
+*/
+SDL_Surface* IVSCALE::halve(SDL_Surface* source) {
+	if (!source || source->format->BytesPerPixel != 4) return nullptr;
+
+	SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, std::max(1, source->w / 2), std::max(1, source->h / 2), 32, source->format->format);
+	if (!target) return nullptr;
+
+	int threads = std::max(1, std::min((int) std::thread::hardware_concurrency(), target->h / SCALE_THREAD_ROWS));
+	if (threads == 1) {
+		halveRows(source, target, 0, target->h);
+		return target;
+	}
+
+	std::vector<std::thread> bands;
+	int rows = (target->h + threads - 1) / threads;
+	for (int first = 0; first < target->h; first += rows) {
+		bands.emplace_back(halveRows, source, target, first, std::min(target->h, first + rows));
+	}
+	for (auto& band : bands) band.join();
+	return target;
+}
@@ -0,0 +1,22 @@
+/*
+IVSCALE.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>		//standard number formats
+
+#ifndef IVSCALE_H
+#define IVSCALE_H
+
+#define SCALE_THREAD_ROWS 64	// fewest output rows worth handing to a thread of their own
+
+/* CPU resampling for mip levels, shared by single texture images and tile pyramids. Safe to call from any thread */
+namespace IVSCALE {
+	/* Halve a 32 BPP surface with a 2x2 area average, across every core. Returns a new surface of the same format, nullptr on failure */
+	SDL_Surface* halve(SDL_Surface* source);
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+IVTRACE.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVTrace.hpp"
+
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <unordered_map>
+
+namespace IVTRACE {
+	std::atomic<bool> enabled{false};
+
+	namespace {
+		struct event {
+			const char* name;
+			std::string detail;
+			int64_t begin;		// microseconds since start()
+			int64_t duration;	// -1 for instant events
+			uint32_t thread;
+		};
+
+		std::filesystem::path output;
+		std::chrono::steady_clock::time_point origin;
+		std::vector<event> events;
+		std::unordered_map<std::thread::id, uint32_t> threads;
+		std::mutex lock;
+
+		int64_t now() {
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+		}
+
+		/* Small stable number per thread, so the trace viewer shows one row each */
+		uint32_t threadNumber() {
+			auto found = threads.find(std::this_thread::get_id());
+			if (found != threads.end()) return found->second;
+			uint32_t number = threads.size() + 1;
+			threads[std::this_thread::get_id()] = number;
+			return number;
+		}
+
+		void record(const char* name, std::string& detail, int64_t begin, int64_t duration) {
+			std::lock_guard<std::mutex> guard(lock);
+			events.push_back({name, detail, begin, duration, threadNumber()});
+		}
+
+		std::string escape(const std::string& value) {
+			std::string out;
+			for (char c : value) {
+				if (c == '"' || c == '\\') out += '\\';
+				if ((unsigned char) c < 0x20) out += ' ';
+				else out += c;
+			}
+			return out;
+		}
+	}
+}
+
+/**
+* start	- Begin collecting events
+* file 	> Where stop() will write them
+*/
+void IVTRACE::start(std::filesystem::path file) {
+	std::lock_guard<std::mutex> guard(lock);
+	output = file;
+	origin = std::chrono::steady_clock::now();
+	events.clear();
+	threads.clear();
+	threads[std::this_thread::get_id()] = 1;	// the thread that starts tracing is the main thread
+	enabled = true;
+}
+
+/**
+* stop 			- Stop collecting and write everything collected in Chrome's trace event format
+* return - bool	< False if the file could not be written
+*/
+bool IVTRACE::stop() {
+	if (!enabled.exchange(false)) return true;
+
+	std::lock_guard<std::mutex> guard(lock);
+	std::ofstream file(output);
+	if (!file) return false;
+
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"main\"}}";
+	for (event& e : events) {
+		file << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"viewer\", \"pid\": 1, \"tid\": " << e.thread << ", \"ts\": " << e.begin;
+		if (e.duration < 0) file << ", \"ph\": \"i\", \"s\": \"t\"";
+		else file << ", \"ph\": \"X\", \"dur\": " << e.duration;
+		if (!e.detail.empty()) file << ", \"args\": {\"detail\": \"" << escape(e.detail) << "\"}";
+		file << "}";
+	}
+	file << "\n]}\n";
+
+	events.clear();
+	return (bool) file;
+}
+
+/**
+* instant	- Record a zero length event
+* name 		> Event name, must outlive tracing (a string literal)
+* detail 	> Extra information shown with the event
+*/
+void IVTRACE::instant(const char* name, std::string detail) {
+	if (!enabled) return;
+	record(name, detail, now(), -1);
+}
+
+IVTRACE::Scope::Scope(const char* name, std::string detail) {
+	this->name = name;
+	this->begin = 0;
+	if (!enabled) return;
+	this->detail = detail;
+	this->begin = now();
+}
+
+IVTRACE::Scope::~Scope() {
+	if (!enabled) return;
+	record(this->name, this->detail, this->begin, now() - this->begin);
+}
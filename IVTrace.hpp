@@ -0,0 +1,48 @@
+/*
+IVTRACE.HPP
+NICK WILSON
+2020
+*/
+
+#include <cstdint>		//standard number formats
+#include <string>		//string type
+#include <filesystem>	//fs path
+#include <atomic>		//enabled flag
+
+#ifndef IVTRACE_H
+#define IVTRACE_H
+
+/* Scoped timing events written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). Costs one atomic load when off */
+namespace IVTRACE {
+	extern std::atomic<bool> enabled;
+
+	/* Start collecting events, to be written to file by stop() */
+	void start(std::filesystem::path file);
+
+	/* Write collected events out and stop collecting. Returns false if the file could not be written */
+	bool stop();
+
+	/* Record a zero length event, such as the first present of an image */
+	void instant(const char* name, std::string detail = "");
+
+	/* Records an event covering its own lifetime */
+	class Scope {
+	private:
+		const char* name;
+		std::string detail;
+		int64_t begin;
+
+	public:
+		Scope(const char* name, std::string detail = "");
+
+		~Scope();
+	};
+}
+
+#define IVTRACE_CONCAT_(a, b) a##b
+#define IVTRACE_CONCAT(a, b) IVTRACE_CONCAT_(a, b)
+
+/* Time the rest of the enclosing block, with an optional detail string (usually a path) */
+#define IVTRACE_SCOPE(...) IVTRACE::Scope IVTRACE_CONCAT(ivtrace_scope_, __LINE__)(__VA_ARGS__)
+
+#endif
@@ -6,85 +6,6 @@ NICK WILSON
 
 #include "IVUtil.hpp"
 
-/**
-* formatSupport	- Compare file extension provided to known list to confirm support
-* extension 	> File extension as String
-* return - int 	< FILE_TYPE of file type or -1 if no match
-*/
-int IVUTIL::formatSupport(std::string extension) {
-	// convert character to upper case for comparison
-	auto upper = [](char a) -> char {
-		if (a > 0x60 && a < 0x7B) return (char) (a - 0x20);
-		else return a;
-	};
-
-	// convert extension string, ignoring leading dot
-	std::string extensionUppercase = "";
-	for (unsigned i = 1; i < extension.length(); i++) {
-		extensionUppercase += upper(extension[i]);
-	}
-	
-	// sort by first character of extension
-	switch (extensionUppercase[0]) {
-		case 'B':
-			/* BMP */
-			if (!extensionUppercase.compare("BMP"))  return BMP;
-			break;
-		case 'G':
-			/* GIF */
-			if (!extensionUppercase.compare("GIF"))  return GIF;
-			break;
-		case 'H':
-			/* HEIF */
-			if (!extensionUppercase.compare("HEIF")) return HEIF;
-			if (!extensionUppercase.compare("HEIC")) return HEIF;
-			break;
-		case 'J':
-			/* JP(E)G */
-			if (!extensionUppercase.compare("JPG"))  return JPG;
-			if (!extensionUppercase.compare("JPEG")) return JPG;
-			break;
-		case 'P':
-			/* PNG */
-			if (!extensionUppercase.compare("PNG"))  return PNG;
-			break;
-		case 'T':
-			/* TIF(F) */
-			if (!extensionUppercase.compare("TIF"))  return TIF;
-			if (!extensionUppercase.compare("TIFF")) return TIF;
-			/* TGA */
-			if (!extensionUppercase.compare("TGA"))  return TGA;
-			break;
-		default:
-			return -1;
-	}
-
-	return -1;
-}
-
-
-/**
-* formatSupport	- Return library supporting file type
-* extension 	> File extension as String
-* return - int 	< LIB_TYPE_SUPPORT or -1 if unsupported
-*/
-int IVUTIL::libSupport(std::string extension) {
-	switch (formatSupport(extension)) {
-		case BMP:
-		case JPG:
-		case PNG:
-		case TIF:
-		case TGA:
-			return TYPE_SDL;
-		case GIF:
-			return TYPE_GIFLIB;
-		case HEIF:
-			return TYPE_LIBHEIF;
-		default:
-			return -1;
-	}
-}
-
 /**
 * readSettings - Load settings file if possible and recover window position and size.
 */
@@ -56,12 +56,11 @@ namespace IVUTIL {
 		int WIN_H;
 		bool MAXIMIZED;
 		bool DISPLAY_MODE_DARK;
+		uint32_t CACHE_LIMIT_MB;
+		uint32_t SORT_ORDER;
+		bool FILMSTRIP;
 	};
 
-	int formatSupport(std::string extension);
-
-	int libSupport(std::string extension);
-
 	void readSettings(std::filesystem::path target, IVSETTINGS* settings);
 	
 	void writeSettings(std::filesystem::path target, IVSETTINGS* settings);
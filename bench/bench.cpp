@@ -0,0 +1,629 @@
+/*
+BENCH.CPP
+NICK WILSON
+2020
+*/
+
+/*
+	Headless benchmark for the load and draw pipeline.
+	Builds on Linux only (see 'make bench'), runs against SDL's dummy video driver and software renderer.
+
+	USAGE: bench [corpus directory] [output file]
+
+	A synthetic corpus is generated in the corpus directory on first run and reused after that.
+	Every case is repeated and each stage reports min/median/mean milliseconds, plus the peak
+	resident memory of the case, as JSON.
+*/
+
+/* /// IMPORTS /// */
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "IVUtil.hpp"
+#include "IVRender.hpp"
+#include "subclasses/Window.hpp"
+#include "subclasses/TiledTexture.hpp"
+#include "subclasses/IVCompositor.hpp"
+
+#include "subclasses/IVImage.hpp"
+#include "subclasses/IVStaticImage.hpp"
+#include "subclasses/IVAnimatedImage.hpp"
+
+#include "gif_lib.h"
+#include "libheif/heif_cxx.h"
+
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <ctime>
+
+/* /// CONSTANTS /// */
+
+namespace BENCH {
+	const int WINDOW_W = 1280;
+	const int WINDOW_H = 720;
+
+	const int REPEATS = 5;		// times each case is run
+	const int DRAWS = 30;		// frames drawn per run once the image is up
+
+	const int GIF_FRAMES = 24;
+	const int GIF_DELAY = 10;	// hundredths of a second
+
+	struct size {
+		int w, h;
+	};
+
+	const std::vector<size> STATIC_SIZES = {{640, 480}, {1920, 1080}, {4096, 3072}, {10000, 6000}};
+	const std::vector<size> ANIMATED_SIZES = {{320, 240}, {1280, 720}};
+
+	// formats with slow encoders are kept to the smaller sizes
+	const int TIFF_MAX_SIDE = 4096;
+	const int HEIF_MAX_SIDE = 4096;
+
+	const int CHECKERBOARD = 16;
+}
+
+/* /// GLOBALS /// */
+
+// draws in place of the software renderer, as the viewer does
+std::unique_ptr<IVCompositor> COMPOSITOR;
+
+/* /// TIMING /// */
+
+typedef std::map<std::string, std::vector<double>> stages;
+
+/**
+* Stopwatch - Collects elapsed milliseconds per named stage
+*/
+class Stopwatch {
+private:
+	std::chrono::steady_clock::time_point start;
+
+public:
+	stages* record;
+
+	Stopwatch(stages* record) : record(record) { reset(); }
+
+	void reset() { start = std::chrono::steady_clock::now(); }
+
+	/* Record the time since the last lap (or reset) under the provided stage name */
+	void lap(std::string stage) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		(*record)[stage].push_back(std::chrono::duration<double, std::milli>(now - start).count());
+		start = now;
+	}
+};
+
+struct result {
+	std::string name;
+	std::string kind;
+	std::string format;
+	int w, h;
+	uintmax_t file_bytes;
+	stages timings;
+	long peak_kb;
+	std::string error;
+};
+
+/* /// MEMORY /// */
+
+/**
+* resetPeakMemory - Reset the kernel's resident high water mark so the next case is measured on its own
+*/
+void resetPeakMemory() {
+	std::ofstream clear("/proc/self/clear_refs");
+	if (clear) clear << "5";
+}
+
+/**
+* peakMemory 	- Resident high water mark of the process
+* return - long	< Kilobytes, -1 if unavailable
+*/
+long peakMemory() {
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.rfind("VmHWM:", 0) == 0) return std::stol(line.substr(6));
+	}
+	return -1;
+}
+
+/* /// CORPUS /// */
+
+/**
+* fillPattern	- Deterministic content with both smooth and busy areas so encoders have real work to do
+* surface 		> 24 or 32 bit surface to fill
+*/
+void fillPattern(SDL_Surface* surface) {
+	uint32_t seed = 0x12345678;
+	for (int y = 0; y < surface->h; y++) {
+		uint8_t* row = (uint8_t*) surface->pixels + y * surface->pitch;
+		for (int x = 0; x < surface->w; x++) {
+			seed = seed * 1664525 + 1013904223;
+			uint8_t noise = (seed >> 24) & 0x1F;
+			uint8_t r = (x * 255) / surface->w;
+			uint8_t g = (y * 255) / surface->h;
+			uint8_t b = ((x ^ y) & 0xFF) / 2 + noise;
+			uint32_t pixel = SDL_MapRGB(surface->format, r, g, b);
+			memcpy(row + x * surface->format->BytesPerPixel, &pixel, surface->format->BytesPerPixel);
+		}
+	}
+}
+
+/**
+* writeTIFF	- Write an uncompressed RGB TIFF, as SDL_image can read but not write them
+* surface 	> RGB24 surface
+* path 		> Output file
+*/
+bool writeTIFF(SDL_Surface* surface, std::filesystem::path path) {
+	std::ofstream out(path, std::ios::binary);
+	if (!out) return false;
+
+	auto u16 = [&](uint16_t v) { out.put(v & 0xFF); out.put(v >> 8); };
+	auto u32 = [&](uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); };
+
+	const uint16_t entries = 9;
+	uint32_t ifd = 8;
+	uint32_t bps = ifd + 2 + entries * 12 + 4;
+	uint32_t data = bps + 6;
+	uint32_t length = surface->w * surface->h * 3;
+
+	auto tag = [&](uint16_t id, uint16_t type, uint32_t count, uint32_t value) {
+		u16(id); u16(type); u32(count);
+		if (type == 3 && count == 1) { u16(value); u16(0); }
+		else u32(value);
+	};
+
+	out.write("II*\0", 4);
+	u32(ifd);
+	u16(entries);
+	tag(256, 4, 1, surface->w);		// ImageWidth
+	tag(257, 4, 1, surface->h);		// ImageLength
+	tag(258, 3, 3, bps);			// BitsPerSample
+	tag(259, 3, 1, 1);				// Compression: none
+	tag(262, 3, 1, 2);				// PhotometricInterpretation: RGB
+	tag(273, 4, 1, data);			// StripOffsets
+	tag(277, 3, 1, 3);				// SamplesPerPixel
+	tag(278, 4, 1, surface->h);		// RowsPerStrip
+	tag(279, 4, 1, length);			// StripByteCounts
+	u32(0);
+	u16(8); u16(8); u16(8);
+
+	for (int y = 0; y < surface->h; y++) {
+		out.write((char*) surface->pixels + y * surface->pitch, surface->w * 3);
+	}
+	return (bool) out;
+}
+
+/**
+* writeGIF	- Write an animated GIF where every frame covers the canvas
+* w, h 		> Canvas size
+* path 		> Output file
+*/
+bool writeGIF(int w, int h, std::filesystem::path path) {
+	int error;
+	GifFileType* gif = EGifOpenFileName(path.string().c_str(), false, &error);
+	if (!gif) return false;
+
+	GifColorType colours[256];
+	for (int i = 0; i < 256; i++) {
+		colours[i] = {(GifByteType) i, (GifByteType) (255 - i), (GifByteType) ((i * 7) & 0xFF)};
+	}
+	ColorMapObject* map = GifMakeMapObject(256, colours);
+
+	EGifSetGifVersion(gif, true);
+	bool ok = EGifPutScreenDesc(gif, w, h, 8, 0, map) != GIF_ERROR;
+
+	// loop forever
+	const char* netscape = "NETSCAPE2.0";
+	GifByteType loop[] = {0x01, 0x00, 0x00};
+	ok = ok && EGifPutExtensionLeader(gif, APPLICATION_EXT_FUNC_CODE) != GIF_ERROR;
+	ok = ok && EGifPutExtensionBlock(gif, 11, netscape) != GIF_ERROR;
+	ok = ok && EGifPutExtensionBlock(gif, 3, loop) != GIF_ERROR;
+	ok = ok && EGifPutExtensionTrailer(gif) != GIF_ERROR;
+
+	std::vector<GifByteType> line(w);
+	for (int f = 0; ok && f < BENCH::GIF_FRAMES; f++) {
+		GifByteType gcb[] = {0x00, BENCH::GIF_DELAY & 0xFF, BENCH::GIF_DELAY >> 8, 0x00};
+		ok = EGifPutExtension(gif, GRAPHICS_EXT_FUNC_CODE, 4, gcb) != GIF_ERROR;
+		ok = ok && EGifPutImageDesc(gif, 0, 0, w, h, false, nullptr) != GIF_ERROR;
+		for (int y = 0; ok && y < h; y++) {
+			for (int x = 0; x < w; x++) line[x] = (x + y + f * 8) & 0xFF;
+			ok = EGifPutLine(gif, line.data(), w) != GIF_ERROR;
+		}
+	}
+
+	GifFreeMapObject(map);
+	return (EGifCloseFile(gif, &error) != GIF_ERROR) && ok;
+}
+
+/**
+* writeHEIF	- Encode an RGB surface with libheif's HEVC encoder
+* surface 	> RGB24 surface
+* path 		> Output file
+*/
+bool writeHEIF(SDL_Surface* surface, std::filesystem::path path) {
+	try {
+		heif::Image image;
+		image.create(surface->w, surface->h, heif_colorspace_RGB, heif_chroma_interleaved_RGB);
+		image.add_plane(heif_channel_interleaved, surface->w, surface->h, 8);
+
+		int stride;
+		uint8_t* plane = image.get_plane(heif_channel_interleaved, &stride);
+		for (int y = 0; y < surface->h; y++) {
+			memcpy(plane + y * stride, (uint8_t*) surface->pixels + y * surface->pitch, surface->w * 3);
+		}
+
+		heif::Context ctx;
+		heif::Encoder encoder(heif_compression_HEVC);
+		encoder.set_lossy_quality(80);
+		ctx.encode_image(image, encoder);
+		ctx.write_to_file(path.string());
+	}
+	catch (...) {
+		return false;
+	}
+	return true;
+}
+
+/**
+* corpusFile	- Path of a corpus file, generating it if it doesn't exist yet
+* corpus 		> Corpus directory
+* format 		> File extension without the dot
+* size 			> Image size
+* return - path	< Empty if the format couldn't be written
+*/
+std::filesystem::path corpusFile(std::filesystem::path corpus, std::string format, BENCH::size size) {
+	std::filesystem::path path = corpus / (std::to_string(size.w) + "x" + std::to_string(size.h) + "." + format);
+	if (std::filesystem::exists(path)) return path;
+
+	std::cout << IVUTIL::LOG_NOTICE << "Generating " << path.string() << std::endl;
+
+	bool ok = false;
+	if (format == "gif") {
+		ok = writeGIF(size.w, size.h, path);
+	}
+	else {
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size.w, size.h, 24, SDL_PIXELFORMAT_RGB24);
+		if (!surface) return {};
+		fillPattern(surface);
+
+		if (format == "png") ok = !IMG_SavePNG(surface, path.string().c_str());
+		else if (format == "jpg") ok = !IMG_SaveJPG(surface, path.string().c_str(), 90);
+		else if (format == "tiff") ok = writeTIFF(surface, path);
+		else if (format == "heic") ok = writeHEIF(surface, path);
+
+		SDL_FreeSurface(surface);
+	}
+
+	if (!ok) {
+		std::cerr << IVUTIL::LOG_WARNING << "Could not generate " << path.string() << ", skipping" << std::endl;
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		return {};
+	}
+	return path;
+}
+
+/* /// CASES /// */
+
+/**
+* drawScene		- Draw the background and image the way the viewer would, through the compositor if it's in use
+* win 			> Target window
+* background 	> Checkerboard
+* image 		> Image to draw, may be null
+* zoom 			> Viewer zoom level
+*/
+void drawScene(Window* win, TiledTexture* background, IVImage* image, float zoom) {
+	if (COMPOSITOR) {
+		SDL_Rect placed = {0, 0, 0, 0};
+		if (image) placed = IVRENDER::placeImage(win, image, zoom, 0, 0);
+		COMPOSITOR->draw(win, background, image, &placed);
+		return;
+	}
+
+	SDL_RenderClear(win->renderer);
+	SDL_Rect placed;
+	if (image && image->opaque) placed = IVRENDER::placeImage(win, image, zoom, 0, 0);
+	IVRENDER::drawTileTexture(win, background, (image && image->opaque) ? &placed : nullptr);
+	if (image) IVRENDER::drawImage(win, image, zoom, 0, 0);
+}
+
+/**
+* drawFrames	- Draw the full scene (background and image) a number of times
+* win 			> Target window
+* background 	> Checkerboard
+* image 		> Image to draw, may be null
+* zoom 			> Viewer zoom level
+* clock 		> Stopwatch, a lap named stage is recorded per frame
+* stage 		> Stage name
+*/
+void drawFrames(Window* win, TiledTexture* background, IVImage* image, float zoom, Stopwatch* clock, std::string stage) {
+	for (int i = 0; i < BENCH::DRAWS; i++) {
+		clock->reset();
+		drawScene(win, background, image, zoom);
+		SDL_RenderPresent(win->renderer);
+		clock->lap(stage);
+	}
+}
+
+/**
+* runStatic	- Time the stages an IVStaticImage goes through, along with the raw library cost for comparison
+*/
+void runStatic(Window* win, TiledTexture* background, std::filesystem::path path, result* r) {
+	Stopwatch clock(&r->timings);
+	const IVFORMAT::format* format = IVFORMAT::detect(path);
+	bool sdl = format && format->library == IVUTIL::TYPE_SDL;
+
+	for (int i = 0; i < BENCH::REPEATS; i++) {
+		if (sdl) {
+			// what SDL_image and the pixel format conversion cost on their own
+			clock.reset();
+			SDL_Surface* raw = IMG_Load(path.string().c_str());
+			clock.lap("load");
+			if (raw) {
+				SDL_Surface* converted = SDL_ConvertSurfaceFormat(raw, SDL_PIXELFORMAT_ARGB8888, 0);
+				clock.lap("convert");
+				SDL_FreeSurface(converted);
+				SDL_FreeSurface(raw);
+			}
+		}
+
+		IVStaticImage image(path);
+		// timed as the image being opened, not a prefetch
+		image.progressive = true;
+		clock.reset();
+		image.decode();
+		clock.lap("decode");
+		image.upload(win->renderer);
+		clock.lap("upload");
+
+		// grid HEIFs keep decoding after upload() and fill the texture in as their tiles finish
+		if (image.arriving()) {
+			while (image.arriving()) {
+				if (image.advance(std::chrono::steady_clock::now())) image.prepare();
+				else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			clock.lap("tiles");
+		}
+
+		// first draw includes uploading tiles for tiled images
+		drawFrames(win, background, &image, 1.0f, &clock, "draw");
+		drawFrames(win, background, &image, 4.0f, &clock, "draw_zoomed");
+	}
+}
+
+/**
+* runAnimated	- Time loading an IVAnimatedImage and stepping through its frames
+*/
+void runAnimated(Window* win, TiledTexture* background, std::filesystem::path path, result* r) {
+	Stopwatch clock(&r->timings);
+
+	for (int i = 0; i < BENCH::REPEATS; i++) {
+		IVAnimatedImage image(path);
+		clock.reset();
+		image.decode();
+		clock.lap("decode");
+		image.upload(win->renderer);
+		clock.lap("upload");
+
+		// drive the scheduler with a fake clock so every step lands on exactly one new frame
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		image.advance(now);
+		for (int f = 0; f < BENCH::GIF_FRAMES; f++) {
+			now += std::chrono::milliseconds(BENCH::GIF_DELAY * 10);
+			clock.reset();
+			if (image.advance(now)) image.prepare();
+			clock.lap("frame");
+
+			drawScene(win, background, &image, 1.0f);
+			SDL_RenderPresent(win->renderer);
+			clock.lap("draw");
+		}
+	}
+}
+
+/**
+* runBackground	- Time creating and drawing the checkerboard on its own
+*/
+void runBackground(Window* win, result* r) {
+	Stopwatch clock(&r->timings);
+
+	for (int i = 0; i < BENCH::REPEATS; i++) {
+		clock.reset();
+		TiledTexture background(win->renderer, BENCH::CHECKERBOARD, BENCH::CHECKERBOARD, 0x00FFFFFF, 0x00CCCCCC);
+		clock.lap("create");
+		drawFrames(win, &background, nullptr, 1.0f, &clock, "draw");
+	}
+}
+
+/* /// OUTPUT /// */
+
+/* Escape the characters JSON doesn't allow in strings */
+std::string jsonString(std::string value) {
+	std::string out = "\"";
+	for (char c : value) {
+		if (c == '"' || c == '\\') out += '\\';
+		if ((unsigned char) c < 0x20) out += ' ';
+		else out += c;
+	}
+	return out + "\"";
+}
+
+/**
+* writeResults	- Write every case and its stage summaries as JSON
+* path 			> Output file
+* renderer 		> Renderer name, recorded for context
+* results 		> Completed cases
+*/
+bool writeResults(std::filesystem::path path, std::string renderer, std::vector<result>& results) {
+	std::ostringstream out;
+	SDL_version linked;
+	SDL_GetVersion(&linked);
+
+	out << "{\n";
+	out << "\t\"timestamp\": " << (long long) std::time(nullptr) << ",\n";
+	out << "\t\"sdl\": " << jsonString(std::to_string(linked.major) + "." + std::to_string(linked.minor) + "." + std::to_string(linked.patch)) << ",\n";
+	out << "\t\"renderer\": " << jsonString(renderer) << ",\n";
+	out << "\t\"window\": [" << BENCH::WINDOW_W << ", " << BENCH::WINDOW_H << "],\n";
+	out << "\t\"repeats\": " << BENCH::REPEATS << ",\n";
+	out << "\t\"cases\": [";
+
+	for (size_t i = 0; i < results.size(); i++) {
+		result& r = results[i];
+		out << (i ? "," : "") << "\n\t\t{\n";
+		out << "\t\t\t\"name\": " << jsonString(r.name) << ",\n";
+		out << "\t\t\t\"kind\": " << jsonString(r.kind) << ",\n";
+		out << "\t\t\t\"format\": " << jsonString(r.format) << ",\n";
+		out << "\t\t\t\"width\": " << r.w << ",\n";
+		out << "\t\t\t\"height\": " << r.h << ",\n";
+		out << "\t\t\t\"file_bytes\": " << r.file_bytes << ",\n";
+		out << "\t\t\t\"peak_rss_kb\": " << r.peak_kb << ",\n";
+		if (!r.error.empty()) out << "\t\t\t\"error\": " << jsonString(r.error) << ",\n";
+		out << "\t\t\t\"stages_ms\": {";
+
+		bool first = true;
+		for (auto& [stage, samples] : r.timings) {
+			std::vector<double> sorted = samples;
+			std::sort(sorted.begin(), sorted.end());
+			double total = 0;
+			for (double s : sorted) total += s;
+
+			out << (first ? "" : ",") << "\n\t\t\t\t" << jsonString(stage) << ": {";
+			out << "\"min\": " << sorted.front();
+			out << ", \"median\": " << sorted[sorted.size() / 2];
+			out << ", \"mean\": " << total / sorted.size();
+			out << ", \"samples\": " << sorted.size() << "}";
+			first = false;
+		}
+		out << "\n\t\t\t}\n\t\t}";
+	}
+	out << "\n\t]\n}\n";
+
+	std::ofstream file(path);
+	file << out.str();
+	return (bool) file;
+}
+
+/* /// MAIN /// */
+
+int main(int argc, char* argv[]) {
+	std::filesystem::path corpus = (argc > 1) ? argv[1] : "bench/corpus";
+	std::filesystem::path output = (argc > 2) ? argv[2] : "bench/results.json";
+
+	// headless unless told otherwise
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		std::cerr << IVUTIL::LOG_ERROR << "SDL INIT FAILED: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF);
+
+	std::error_code error;
+	std::filesystem::create_directories(corpus, error);
+
+	std::vector<result> results;
+	std::string rendererName = "unknown";
+
+	{
+		Window win(BENCH::WINDOW_W, BENCH::WINDOW_H, 0, 0, SDL_WINDOW_HIDDEN);
+		if (!win.renderer) {
+			std::cerr << IVUTIL::LOG_ERROR << "COULD NOT CREATE RENDERER: " << SDL_GetError() << std::endl;
+			return 1;
+		}
+
+		SDL_RendererInfo rendererInfo;
+		if (!SDL_GetRendererInfo(win.renderer, &rendererInfo)) {
+			rendererName = rendererInfo.name;
+			if (rendererInfo.max_texture_width > 0) {
+				IVStaticImage::texture_max_w = rendererInfo.max_texture_width;
+				IVStaticImage::texture_max_h = rendererInfo.max_texture_height;
+			}
+		}
+		IVImage::texture_format = IVRENDER::nativeFormat(win.renderer);
+		IVImage::texture_formats = IVRENDER::textureFormats(win.renderer);
+
+		// the software renderer is what the viewer replaces with its own compositor, BENCH_RENDERER=1 keeps it for comparison
+		const char* keepRenderer = SDL_getenv("BENCH_RENDERER");
+		if ((!keepRenderer || strcmp(keepRenderer, "1")) && IVCompositor::usable(&win)) {
+			COMPOSITOR = std::make_unique<IVCompositor>();
+			IVImage::keep_pixels = true;
+			IVImage::texture_format = SDL_PIXELFORMAT_ARGB8888;
+			IVImage::texture_formats = {SDL_PIXELFORMAT_ARGB8888};
+			rendererName += " (compositor)";
+		}
+
+		TiledTexture background(win.renderer, BENCH::CHECKERBOARD, BENCH::CHECKERBOARD, 0x00FFFFFF, 0x00CCCCCC);
+
+		std::vector<std::pair<std::string, BENCH::size>> cases;
+		for (std::string format : {"jpg", "png", "tiff", "heic"}) {
+			for (BENCH::size size : BENCH::STATIC_SIZES) {
+				int side = std::max(size.w, size.h);
+				if (format == "tiff" && side > BENCH::TIFF_MAX_SIDE) continue;
+				if (format == "heic" && side > BENCH::HEIF_MAX_SIDE) continue;
+				cases.push_back({format, size});
+			}
+		}
+		for (BENCH::size size : BENCH::ANIMATED_SIZES) cases.push_back({"gif", size});
+
+		for (auto& [format, size] : cases) {
+			std::filesystem::path path = corpusFile(corpus, format, size);
+			if (path.empty()) continue;
+
+			result r;
+			r.name = path.filename().string();
+			r.kind = (format == "gif") ? "animated" : "static";
+			r.format = format;
+			r.w = size.w;
+			r.h = size.h;
+			r.file_bytes = std::filesystem::file_size(path, error);
+
+			std::cout << IVUTIL::LOG_NOTICE << "Running " << r.name << std::endl;
+			resetPeakMemory();
+			try {
+				if (format == "gif") runAnimated(&win, &background, path, &r);
+				else runStatic(&win, &background, path, &r);
+			}
+			catch (IVUTIL::IVEXCEPT e) {
+				r.error = "load failed (" + std::to_string((int) e) + ")";
+				std::cerr << IVUTIL::LOG_WARNING << "Could not load " << r.name << std::endl;
+			}
+			r.peak_kb = peakMemory();
+			results.push_back(r);
+		}
+
+		result r;
+		r.name = "checkerboard";
+		r.kind = "background";
+		r.format = "";
+		r.w = BENCH::WINDOW_W;
+		r.h = BENCH::WINDOW_H;
+		r.file_bytes = 0;
+		resetPeakMemory();
+		runBackground(&win, &r);
+		r.peak_kb = peakMemory();
+		results.push_back(r);
+	}
+
+	IMG_Quit();
+	SDL_Quit();
+
+	if (!writeResults(output, rendererName, results)) {
+		std::cerr << IVUTIL::LOG_ERROR << "Could not write " << output.string() << std::endl;
+		return 1;
+	}
+	std::cout << IVUTIL::LOG_NOTICE << "Results written to " << output.string() << std::endl;
+	return 0;
+}
@@ -10,14 +10,24 @@ NICK WILSON
 #include <SDL2/SDL_image.h>
 
 #include "IVUtil.hpp"
+#include "IVFormat.hpp"
+#include "IVRender.hpp"
+#include "IVTrace.hpp"
 #include "subclasses/Window.hpp"
 #include "subclasses/TiledTexture.hpp"
 
 #include "subclasses/IVImage.hpp"
 #include "subclasses/IVStaticImage.hpp"
 #include "subclasses/IVAnimatedImage.hpp"
+#include "subclasses/IVImageCache.hpp"
+#include "subclasses/IVDecoder.hpp"
+#include "subclasses/IVFolderIndex.hpp"
+#include "subclasses/IVThumbnailCache.hpp"
+#include "subclasses/IVFilmstrip.hpp"
+#include "subclasses/IVCompositor.hpp"
 
 #include <string>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -26,6 +36,7 @@ NICK WILSON
 #include <filesystem>
 #include <vector>
 #include <memory>
+#include <unordered_set>
 
 #ifndef WIN32_LEAN_AND_MEAN
 	#define WIN32_LEAN_AND_MEAN
@@ -63,6 +74,15 @@ namespace IVC {
 	const uint32_t COLOUR_L_L = 0x00F3F3F3;
 	const uint32_t COLOUR_L_D = 0x00DEDEDE;
 
+	/* PREFETCH */
+	const uint32_t CACHE_LIMIT_MB = 512;	// decoded image memory kept for adjacent images
+	const int PREFETCH_AHEAD = 3;			// images decoded in the direction of travel
+	const int PREFETCH_BEHIND = 1;			// images kept decoded behind
+	const unsigned DECODE_THREADS = 4;		// upper limit on background decode workers
+
+	/* BROWSING */
+	const std::string SORT_NAMES[IVFolderIndex::ORDER_COUNT] = {"name", "natural name", "date modified", "size"};
+
 	// These are the default values for the settings.
 	// If adding a new setting, be sure to add a sensible default here too.
 	const struct IVUTIL::IVSETTINGS DEFAULTS = {
@@ -71,10 +91,14 @@ namespace IVC {
 		IVC::WIN_DEFAULT_W,
 		IVC::WIN_DEFAULT_H,
 		false,
+		true,
+		IVC::CACHE_LIMIT_MB,
+		IVFolderIndex::ORDER_NAME,
 		true
 	};
 
 	const std::string FILENAME_SETTINGS = "settings.cfg";
+	const std::string FILENAME_THUMBNAILS = "thumbnails.cache";
 }
 
 /* /// GLOBALS /// */
@@ -99,13 +123,35 @@ namespace IVG {
 	std::filesystem::path PATH_PROGRAM_CWD;
 	std::filesystem::path PATH_IMAGE_FILE;
 
-	std::vector<std::filesystem::path> FILES_IMAGES_ADJACENT;
-	uint32_t INDEX_IMAGE_FILE = 0;
+	std::unique_ptr<IVFolderIndex> FOLDER;	// the open image's folder, in browsing order
+	uint32_t EVENT_FOLDER = 0;
+
+	/* FILMSTRIP */
+	std::unique_ptr<IVThumbnailCache> THUMBNAILS;
+	std::unique_ptr<IVFilmstrip> FILMSTRIP;
+	uint32_t EVENT_THUMBNAIL = 0;
 
 	/* Set settings to default values, to be overwritten if settings file is loaded */
 	struct IVUTIL::IVSETTINGS SETTINGS = IVC::DEFAULTS;
 
-	std::unique_ptr<IVImage> IMAGE_CURRENT;
+	std::shared_ptr<IVImage> IMAGE_CURRENT;
+	std::filesystem::path PATH_IMAGE_PENDING;	// image being decoded to replace IMAGE_CURRENT
+	std::filesystem::path PATH_IMAGE_UPGRADE;	// image being decoded at full resolution to replace a reduced IMAGE_CURRENT
+
+	/* DECODING */
+	std::unique_ptr<IVDecoder> DECODER;
+	uint32_t EVENT_DECODED = 0;
+
+	/* PREFETCH */
+	IVImageCache IMAGE_CACHE;
+	int NAVIGATION_DIRECTION = 1;	// +1 moving forward, -1 moving back
+	std::unordered_set<std::string> PREFETCH_FAILED;
+
+	/* SOFTWARE RENDERING */
+	std::unique_ptr<IVCompositor> COMPOSITOR;	// draws the image and background on every core when there's no GPU
+
+	/* TRACING */
+	IVImage* IMAGE_PRESENTED = nullptr;	// last image drawn, to mark the first present of each one
 }
 
 /* /// CODE /// */
@@ -130,110 +176,197 @@ void pushSettings(Window* win) {
 }
 
 /**
-* redrawImage	- Re-render the display image, respecting zoom and pan positioning
-* win 			> Target Window object
-* imageTexture 	> Image as SDL_Texture
+* prefetchWindow	- List the current image and its neighbours in prefetch priority order, favouring the direction of travel
+* return - vector	< Canonical paths
 */
-void redrawImage(Window* win, SDL_Texture* imageTexture) {
-
-	//image is too big for the window
-	if (IVG::IMAGE_CURRENT->h > win->h || IVG::IMAGE_CURRENT->w > win->w) {
-		//determine the shapes of window and image
-		float imageAspectRatio = IVG::IMAGE_CURRENT->w/(float) IVG::IMAGE_CURRENT->h;
-		float windowAspectRatio = win->w/(float) win->h;
-
-		//width is priority
-		if (imageAspectRatio > windowAspectRatio) {
-			//figure out how image will be scaled to fit
-			float imageReduction = win->w/(float) IVG::IMAGE_CURRENT->w;
-			//apply transformation to height
-			int imageTargetHeight = imageReduction * IVG::IMAGE_CURRENT->h;
-
-			//horizontal adjustment
-			int xPos = (win->w - win->w * IVG::VIEWPORT_ZOOM)/2 + IVG::VIEWPORT_X;
-			//vertical adjustment
-			int yPos = (win->h - imageTargetHeight * IVG::VIEWPORT_ZOOM)/2 + IVG::VIEWPORT_Y;
-
-			SDL_Rect windowDestination = {xPos, yPos, (int) (win->w * IVG::VIEWPORT_ZOOM), (int) (imageTargetHeight * IVG::VIEWPORT_ZOOM)};
-			SDL_RenderCopy(win->renderer, imageTexture, 0, &windowDestination);
-		}
-		//height is priority or equal priority
-		else {
-			//figure out how image will be scaled to fit
-			float imageReduction = win->h/(float) IVG::IMAGE_CURRENT->h;
-			//apply transformation to width
-			int imageTargetWidth = imageReduction * IVG::IMAGE_CURRENT->w;
-
-			//horizontal adjustment
-			int xPos = (win->w - imageTargetWidth * IVG::VIEWPORT_ZOOM)/2 + IVG::VIEWPORT_X;
-			//vertical adjustment
-			int yPos = (win->h - win->h * IVG::VIEWPORT_ZOOM)/2 + IVG::VIEWPORT_Y;
-
-			SDL_Rect windowDestination = {xPos, yPos, (int) (imageTargetWidth * IVG::VIEWPORT_ZOOM), (int) (win->h * IVG::VIEWPORT_ZOOM)};
-			SDL_RenderCopy(win->renderer, imageTexture, 0, &windowDestination);
-		}
+std::vector<std::filesystem::path> prefetchWindow() {
+	std::vector<std::filesystem::path> window;
+	if (!IVG::FOLDER || !IVG::FOLDER->size()) return window;
+
+	int ahead = std::min<int>(IVC::PREFETCH_AHEAD, IVG::FOLDER->size() - 1);
+	int behind = std::min<int>(IVC::PREFETCH_BEHIND, IVG::FOLDER->size() - 1 - ahead);
+	window.push_back(IVG::FOLDER->get());
+	for (int i = 1; i <= std::max(ahead, behind); i++) {
+		if (i <= ahead) window.push_back(IVG::FOLDER->at(i * IVG::NAVIGATION_DIRECTION));
+		if (i <= behind) window.push_back(IVG::FOLDER->at(-i * IVG::NAVIGATION_DIRECTION));
 	}
-	//image will fit in existing window
-	else {
-		int xPos = (win->w - IVG::IMAGE_CURRENT->w * IVG::VIEWPORT_ZOOM)/2 + IVG::VIEWPORT_X;
-		int yPos = (win->h - IVG::IMAGE_CURRENT->h * IVG::VIEWPORT_ZOOM)/2 + IVG::VIEWPORT_Y;
-		SDL_Rect windowDestination = {xPos, yPos, (int) (IVG::IMAGE_CURRENT->w * IVG::VIEWPORT_ZOOM), (int) (IVG::IMAGE_CURRENT->h * IVG::VIEWPORT_ZOOM)};
-		SDL_RenderCopy(win->renderer, imageTexture, 0, &windowDestination);
+	return window;
+}
+
+/**
+* windowBytes	- Total cache memory held by a prefetch window
+* window 		> Paths from prefetchWindow()
+*/
+size_t windowBytes(std::vector<std::filesystem::path>& window) {
+	size_t total = 0;
+	for (auto& path : window) total += IVG::IMAGE_CACHE.size(path);
+	return total;
+}
+
+/**
+* prefetchQueue	- Queue every uncached neighbour for decoding in the background
+*/
+void prefetchQueue() {
+	std::vector<std::filesystem::path> window = prefetchWindow();
+
+	// touch the neighbourhood furthest first so the nearest images are the last to be evicted
+	for (auto it = window.rbegin(); it != window.rend(); it++) {
+		IVG::IMAGE_CACHE.get(*it);
+	}
+
+	// neighbours in a folder tend to be alike, so use the current image to guess at their size
+	size_t estimate = IVG::IMAGE_CURRENT ? IVG::IMAGE_CURRENT->bytes() : 0;
+	size_t budget = windowBytes(window);
+
+	for (auto& path : window) {
+		if (IVG::IMAGE_CACHE.contains(path) || IVG::PREFETCH_FAILED.count(path.string())) continue;
+		// animated images are never cached, see receiveDecoded
+		const IVFORMAT::format* format = IVFORMAT::guess(path.extension().string());
+		if (format && (format->capabilities & IVFORMAT::CAN_ANIMATE)) continue;
+
+		budget += estimate;
+		if (budget > IVG::IMAGE_CACHE.limit) break;
+
+		IVG::DECODER->request(path, true);
 	}
 }
 
 /**
-* drawTileTexture	- Tile texture across window
-* win 				> Target Window object
-* tileTexture 		> Texture as SDL_Texture to tile
+* requestImage	- Show an image straight from the cache if it was prefetched, otherwise queue it for decoding
+* filePath 		> The path to the image to load
+* return - bool	< true if the current image changed immediately
 */
-void drawTileTexture(Window* win, TiledTexture* tiledTexture) {
-	for (int h = 0; h < win->h; h += tiledTexture->h){
-		for (int w = 0; w < win->w; w += tiledTexture->w){
-			SDL_Rect destination = {w, h, tiledTexture->w, tiledTexture->h};
-			SDL_RenderCopy(win->renderer, tiledTexture->texture, 0, &destination);
-		}
+bool requestImage(std::filesystem::path filePath) {
+	// anything queued for the previous image is no longer wanted
+	IVG::DECODER->supersede();
+	IVG::PATH_IMAGE_UPGRADE.clear();
+
+	//already decoded, just swap textures
+	std::shared_ptr<IVImage> cached = IVG::IMAGE_CACHE.get(filePath);
+	if (cached) {
+		IVG::PATH_IMAGE_PENDING.clear();
+		IVG::IMAGE_CURRENT = cached;
+	}
+	else {
+		IVG::PATH_IMAGE_PENDING = filePath;
+		IVG::DECODER->request(filePath, false);
+		//camera files carry a thumbnail that can be shown long before the real decode is done
+		const IVFORMAT::format* format = IVFORMAT::guess(filePath.extension().string());
+		if (format && (format->capabilities & IVFORMAT::HAS_THUMBNAIL)) IVG::DECODER->preview(filePath);
 	}
+
+	prefetchQueue();
+	return cached != nullptr;
 }
 
 /**
-* loadTextureFromFile	- Load a file and convert it to an SDL_Texture
-* renderer 				> Target SDL_Renderer
-* filePath 				> The path to the image to load
-* return - int 			< 0 on success or 1 on failure
+* receiveDecoded	- Upload finished decodes, showing the pending image and caching prefetched neighbours
+* renderer 			> Target SDL_Renderer
+* return - int 		< 1 if the current image changed, -1 if the pending image failed to load, 0 otherwise
 */
-int loadTextureFromFile(SDL_Renderer* renderer, std::filesystem::path filePath) {
-	//try loading image from filename
-	int filetype = IVUTIL::libSupport(filePath.extension().string());
-	try {
-		if (filetype == IVUTIL::TYPE_GIFLIB) {
-			//load animated image
-			IVG::IMAGE_CURRENT.reset(new IVAnimatedImage(renderer, filePath));
+int receiveDecoded(SDL_Renderer* renderer) {
+	int status = 0;
+	std::vector<std::filesystem::path> window = prefetchWindow();
+
+	for (auto& done : IVG::DECODER->collect()) {
+		bool wanted = !IVG::PATH_IMAGE_PENDING.empty() && done.path == IVG::PATH_IMAGE_PENDING;
+
+		// an embedded preview stands in until the real decode arrives, unless it's the same file reloading. It's never cached
+		if (done.preview) {
+			if (!done.image || !wanted || (IVG::IMAGE_CURRENT && IVG::IMAGE_CURRENT->path == done.path)) continue;
+			try {
+				IVTRACE_SCOPE("upload", done.path.string());
+				done.image->upload(renderer);
+			}
+			catch (IVUTIL::IVEXCEPT except) {
+				continue;
+			}
+			IVG::IMAGE_CURRENT = done.image;
+			status = 1;
+			continue;
 		}
-		else if (filetype == IVUTIL::TYPE_SDL || filetype == IVUTIL::TYPE_LIBHEIF) {
-			//load static SDL image or static HEIF image
-			IVG::IMAGE_CURRENT.reset(new IVStaticImage(renderer, filePath));
+		// a full resolution decode replaces the reduced one on screen, keeping zoom and pan
+		if (done.full) {
+			if (done.path != IVG::PATH_IMAGE_UPGRADE || !IVG::IMAGE_CURRENT || IVG::IMAGE_CURRENT->path != done.path) continue;
+			wanted = true;
 		}
-		else {
-			return 1;
+
+		if (done.image && !wanted) {
+			bool neighbour = false;
+			for (auto& path : window) neighbour |= (path == done.path);
+
+			// only keep prefetched images that still belong and fit without pushing out closer ones
+			//animated images carry playback state (and may still be reading their file), so only static images are kept around
+			if (!neighbour || done.image->animated || windowBytes(window) + done.image->bytes() > IVG::IMAGE_CACHE.limit) continue;
 		}
-	}
-	catch (IVUTIL::IVEXCEPT except) {
-		switch (except) {
-			case IVUTIL::EXCEPT_IMG_OPEN_FAIL:
-				std::cerr << IVUTIL::LOG_WARNING << "Failed to open image \'" << filePath.string() << "\'" << std::endl;
-				break;
-			case IVUTIL::EXCEPT_IMG_LOAD_FAIL:
-				std::cerr << IVUTIL::LOG_WARNING << "Failed to load image \'" << filePath.string() << "\'" << std::endl;
-				break;
-
-			default:
-				std::cerr << IVUTIL::LOG_WARNING << "Unknown error loading image \'" << filePath << "\'" << std::endl;
-				break;
+
+		if (done.image) {
+			try {
+				IVTRACE_SCOPE("upload", done.path.string());
+				done.image->upload(renderer);
+			}
+			catch (IVUTIL::IVEXCEPT except) {
+				done.image = nullptr;
+				done.error = except;
+			}
+		}
+
+		if (!done.image) {
+			IVG::PREFETCH_FAILED.insert(done.path.string());
+			if (!wanted) continue;
+
+			switch (done.error) {
+				case IVUTIL::EXCEPT_IMG_OPEN_FAIL:
+					std::cerr << IVUTIL::LOG_WARNING << "Failed to open image \'" << done.path.string() << "\'" << std::endl;
+					break;
+				case IVUTIL::EXCEPT_IMG_LOAD_FAIL:
+					std::cerr << IVUTIL::LOG_WARNING << "Failed to load image \'" << done.path.string() << "\'" << std::endl;
+					break;
+
+				default:
+					std::cerr << IVUTIL::LOG_WARNING << "Unknown error loading image \'" << done.path << "\'" << std::endl;
+					break;
+			}
+			IVG::PATH_IMAGE_PENDING.clear();
+			status = -1;
+			continue;
+		}
+
+		if (!done.image->animated) IVG::IMAGE_CACHE.put(done.path, done.image);
+
+		if (wanted) {
+			IVG::IMAGE_CURRENT = done.image;
+			IVG::PATH_IMAGE_PENDING.clear();
+			status = 1;
 		}
-		return 1;
 	}
-	return 0;
+	return status;
+}
+
+/**
+* upgradeCurrent	- Ask for every pixel of the current image once it's shown larger than its reduced decode covers
+* win 				> Target Window object
+*/
+void upgradeCurrent(Window* win) {
+	IVImage* image = IVG::IMAGE_CURRENT.get();
+	if (!image || image->scale == 1 || IVG::PATH_IMAGE_UPGRADE == image->path) return;
+
+	SDL_Rect destination = IVRENDER::placeImage(win, image, IVG::VIEWPORT_ZOOM, IVG::VIEWPORT_X, IVG::VIEWPORT_Y);
+	if (destination.w <= (image->w + image->scale - 1) / image->scale && destination.h <= (image->h + image->scale - 1) / image->scale) return;
+
+	IVG::PATH_IMAGE_UPGRADE = image->path;
+	IVG::DECODER->request(image->path, false, true);
+}
+
+/**
+* imageInView	- Whether any part of the current image lands inside the window at the current zoom and pan
+* win 			> Target Window object
+*/
+bool imageInView(Window* win) {
+	if (!IVG::IMAGE_CURRENT) return false;
+	SDL_Rect window = {0, 0, win->w, win->h};
+	SDL_Rect destination = IVRENDER::placeImage(win, IVG::IMAGE_CURRENT.get(), IVG::VIEWPORT_ZOOM, IVG::VIEWPORT_X, IVG::VIEWPORT_Y);
+	return SDL_HasIntersection(&destination, &window);
 }
 
 /**
@@ -245,17 +378,77 @@ void resetViewport() {
 	IVG::VIEWPORT_Y = 0;
 }
 
+/**
+* showCurrent	- Switch to the folder's current image, resetting zoom and pan
+* win 			> Target Window object
+*/
+void showCurrent(Window* win) {
+	if (!IVG::FOLDER->size()) { //nothing left to show
+		IVG::DECODER->supersede();
+		IVG::PATH_IMAGE_PENDING.clear();
+		IVG::IMAGE_CURRENT.reset();
+		win->setTitle(IVUTIL::APPLICATION_TITLE.c_str());
+		return;
+	}
+	win->setTitle((IVG::FOLDER->get().filename().string() + " - " + IVUTIL::APPLICATION_TITLE).c_str()); //update window title
+	requestImage(IVG::FOLDER->get()); //shown now if prefetched, otherwise once decoded
+	resetViewport(); //new image so reset zoom and positioning
+}
+
+/**
+* reloadCurrent	- Catch up with the current file changing on disk: rewritten files reload in place, removed ones move on to the next image
+* win 			> Target Window object
+*/
+void reloadCurrent(Window* win) {
+	bool shown = IVG::FOLDER->size() && ((IVG::IMAGE_CURRENT && IVG::FOLDER->get() == IVG::IMAGE_CURRENT->path) || IVG::FOLDER->get() == IVG::PATH_IMAGE_PENDING);
+	if (shown) requestImage(IVG::FOLDER->get());
+	else showCurrent(win);
+}
+
 /**
 * draw			- Clear display, then draw tiles and image (if provided)
 * win 			> Target Window object
 * tileTexture 	> Texture as SDL_Texture to tile
-* imageTexture 	> Image as SDL_Texture
+* image 		> Image to draw
 */
-void draw(Window* win, TiledTexture* BGTiledTexture, SDL_Texture* image_texture) {
-	SDL_RenderClear(win->renderer);
-	drawTileTexture(win, BGTiledTexture);
-	if (image_texture) redrawImage(win, image_texture);
-	SDL_RenderPresent(win->renderer);
+void draw(Window* win, TiledTexture* BGTiledTexture, IVImage* image) {
+	IVTRACE_SCOPE("draw");
+	if (IVG::COMPOSITOR) {
+		//every pixel of the window surface is written, the renderer only adds the filmstrip on top
+		SDL_Rect placed = {0, 0, 0, 0};
+		if (image) placed = IVRENDER::placeImage(win, image, IVG::VIEWPORT_ZOOM, IVG::VIEWPORT_X, IVG::VIEWPORT_Y);
+		IVG::COMPOSITOR->draw(win, BGTiledTexture, image, &placed);
+	}
+	else {
+		SDL_RenderClear(win->renderer);
+		//an opaque image hides whatever is behind it, so leave that part of the checkerboard out
+		SDL_Rect placed;
+		if (image && image->opaque) placed = IVRENDER::placeImage(win, image, IVG::VIEWPORT_ZOOM, IVG::VIEWPORT_X, IVG::VIEWPORT_Y);
+		IVRENDER::drawTileTexture(win, BGTiledTexture, (image && image->opaque) ? &placed : nullptr);
+		if (image) IVRENDER::drawImage(win, image, IVG::VIEWPORT_ZOOM, IVG::VIEWPORT_X, IVG::VIEWPORT_Y);
+	}
+	if (IVG::FILMSTRIP) IVG::FILMSTRIP->draw(win, IVG::FOLDER.get());
+	{
+		IVTRACE_SCOPE("present");
+		SDL_RenderPresent(win->renderer);
+	}
+	if (image && image != IVG::IMAGE_PRESENTED && IVTRACE::enabled) IVTRACE::instant("first present", image->path.string());
+	IVG::IMAGE_PRESENTED = image;
+}
+
+/**
+* waitEvent		- Sleep until an event arrives or the provided time is reached, whichever is first
+* event 		< Received event
+* until 		> Time to give up waiting, time_point::max() to wait indefinitely
+* return - bool	< True if an event was received
+*/
+bool waitEvent(SDL_Event* event, std::chrono::steady_clock::time_point until) {
+	if (until == std::chrono::steady_clock::time_point::max()) return SDL_WaitEvent(event);
+
+	// round up, waking a little early would only spin until the time is reached
+	int64_t timeout = std::chrono::ceil<std::chrono::milliseconds>(until - std::chrono::steady_clock::now()).count();
+	if (timeout <= 0) return SDL_PollEvent(event);
+	return SDL_WaitEventTimeout(event, (int) std::min(timeout, (int64_t) INT32_MAX));
 }
 
 /* Format and return version string */
@@ -281,20 +474,38 @@ int main(int argc, char* argv[]) {
 							+ "\nSDL IMAGE VERSION " + versionToString(&IVC::SDL_IMAGE_COMPILED_VERSION);
 
 	/* Process any flags */
-	for (int i = 0; i < argc; i++) {
+	char* imageArgument = nullptr;
+	char* traceArgument = nullptr;
+	int cacheLimitArgument = -1;
+	for (int i = 1; i < argc; i++) {
 		if (argv[i][0] == '-') {
 			switch (argv[i][1]) {
 				case 'v': //-v will print version info
 					std::cout << "=== ABOUT: " << IVUTIL::APPLICATION_TITLE << " ===" << std::endl;
 					std::cout << IVC::VERSION_ABOUT << std::endl;
 					return 0;
+				case 'c': //-c<MB> sets the size of the decoded image cache, 0 disables prefetching
+					cacheLimitArgument = std::max(0, atoi(argv[i] + 2));
+					break;
+				case '-': //--trace <file> writes timing events for viewing in chrome://tracing or Perfetto
+					if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+						traceArgument = argv[++i];
+						break;
+					}
+					std::cout << "Invalid flag: " << argv[i] << std::endl;
+					return 0;
 				default: ///no other flags defined yet
 					std::cout << "Invalid flag: " << argv[i] << std::endl;
 					return 0;
 			}
 		}
+		else if (!imageArgument) {
+			imageArgument = argv[i];
+		}
 	}
 
+	if (traceArgument) IVTRACE::start(traceArgument);
+
 	/* Confirm video is available and set up */
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		std::cerr << IVUTIL::LOG_ERROR << "SDL COULD NOT BE INITIALIZED!" << std::endl;
@@ -310,6 +521,10 @@ int main(int argc, char* argv[]) {
 
 	IVUTIL::readSettings(IVG::PATH_PROGRAM_CWD / IVC::FILENAME_SETTINGS, &IVG::SETTINGS);
 
+	// a cache size passed in is remembered for next time
+	if (cacheLimitArgument >= 0) IVG::SETTINGS.CACHE_LIMIT_MB = cacheLimitArgument;
+	IVG::IMAGE_CACHE.limit = (size_t) IVG::SETTINGS.CACHE_LIMIT_MB << 20;
+
 	/* Create invisible application window */
 	Window win(IVG::SETTINGS.WIN_W, IVG::SETTINGS.WIN_H, IVG::SETTINGS.WIN_X, IVG::SETTINGS.WIN_Y, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | (IVG::SETTINGS.MAXIMIZED ? SDL_WINDOW_MAXIMIZED : 0));
 	win.setTitle(IVUTIL::APPLICATION_TITLE.c_str());
@@ -319,7 +534,7 @@ int main(int argc, char* argv[]) {
 	}
 
 	// No file passed in
-	if (argc < 2) {
+	if (!imageArgument) {
 		std::cerr << IVUTIL::LOG_ERROR << "No arguments provided!" << std::endl;
 		MessageBox(nullptr, "Please provide a path to an image file!", "No filename provided!", MB_OK | MB_ICONERROR);
 		return 1;
@@ -334,6 +549,29 @@ int main(int argc, char* argv[]) {
 		std::cout << IVUTIL::LOG_NOTICE << "Sampling defaulting to nearest neighbour." << std::endl;
 	}
 
+	// JPEGs only need decoding at the size they're shown
+	IVStaticImage::target_w = win.w;
+	IVStaticImage::target_h = win.h;
+
+	// Images larger than this are split into tiles
+	SDL_RendererInfo rendererInfo;
+	if (!SDL_GetRendererInfo(win.renderer, &rendererInfo) && rendererInfo.max_texture_width > 0) {
+		IVStaticImage::texture_max_w = rendererInfo.max_texture_width;
+		IVStaticImage::texture_max_h = rendererInfo.max_texture_height;
+	}
+	// Decoders produce the renderer's own pixel format so textures are filled without conversion
+	IVImage::texture_format = IVRENDER::nativeFormat(win.renderer);
+	IVImage::texture_formats = IVRENDER::textureFormats(win.renderer);
+
+	// Without a GPU the window gets SDL's software renderer (see Window), which scales on one core. Draw on all of them instead
+	if (IVCompositor::usable(&win)) {
+		std::cout << IVUTIL::LOG_NOTICE << "Software renderer, compositing on the CPU." << std::endl;
+		IVG::COMPOSITOR = std::make_unique<IVCompositor>();
+		IVImage::keep_pixels = true;
+		IVImage::texture_format = SDL_PIXELFORMAT_ARGB8888;
+		IVImage::texture_formats = {SDL_PIXELFORMAT_ARGB8888};
+	}
+
 	// Create checkerboard background textures for transparent images
 	TiledTexture TEXTURE_DARK(win.renderer, IVC::RES_CHECKERBOARD, IVC::RES_CHECKERBOARD, IVC::COLOUR_D_L, IVC::COLOUR_D_D);
 	TiledTexture TEXTURE_LIGHT(win.renderer, IVC::RES_CHECKERBOARD, IVC::RES_CHECKERBOARD, IVC::COLOUR_L_L, IVC::COLOUR_L_D);
@@ -343,7 +581,7 @@ int main(int argc, char* argv[]) {
 
 	try {
 		// Determine image filename
-		IVG::PATH_IMAGE_FILE = std::filesystem::canonical(std::filesystem::path(argv[1]));
+		IVG::PATH_IMAGE_FILE = std::filesystem::canonical(std::filesystem::path(imageArgument));
 	} catch (const std::filesystem::filesystem_error& e) {
 		// This happens when there are UTF-8 characters in the path.
 		//TODO: Wide strings
@@ -354,42 +592,36 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	// Determine if file is image type
-	if (IVUTIL::formatSupport(IVG::PATH_IMAGE_FILE.extension().string()) < 0) {
+	// Determine if file is image type, by content rather than extension
+	if (!IVFORMAT::detect(IVG::PATH_IMAGE_FILE)) {
 		std::cerr << IVUTIL::LOG_ERROR << "Not a supported image format!" << std::endl;
-		MessageBox(nullptr, "Please verify the file has a supported file extension.",
+		MessageBox(nullptr, "Please verify the file is a supported image type.",
 							"Invalid image format!", MB_OK | MB_ICONERROR);
 		return 1;
 	}
 
-	// Load up the image passed in
-	if (loadTextureFromFile(win.renderer, IVG::PATH_IMAGE_FILE)) {
-		std::cerr << IVUTIL::LOG_ERROR << IMG_GetError() << std::endl;
-		MessageBox(nullptr, "Please verify the file is not corrupt or misformed.",
-							"Could not load image!", MB_OK | MB_ICONERROR);
-		return 1;
-	}
+	// Start decoding the image passed in, it will be shown as soon as it arrives
+	IVG::EVENT_DECODED = SDL_RegisterEvents(4);
+	IVG::EVENT_FOLDER = IVG::EVENT_DECODED + 1;
+	IVG::EVENT_THUMBNAIL = IVG::EVENT_DECODED + 2;
+	IVImage::event_ready = IVG::EVENT_DECODED + 3;	// only wakes the loop, the current image's advance() finds what's ready
+	IVG::DECODER.reset(new IVDecoder(std::min(IVC::DECODE_THREADS, std::max(1u, std::thread::hardware_concurrency())), IVG::EVENT_DECODED));
+	requestImage(IVG::PATH_IMAGE_FILE);
 
 	// Update window title with image filename
 	win.setTitle((IVG::PATH_IMAGE_FILE.filename().string() + " - " + IVUTIL::APPLICATION_TITLE).c_str());
 
-	// Finally draw image and background
-	draw(&win, (IVG::SETTINGS.DISPLAY_MODE_DARK) ? &TEXTURE_DARK : &TEXTURE_LIGHT, IVG::IMAGE_CURRENT->texture);
-
-	// Iterate image folder and mark position of currently open image
-	int pos = 0;
-	for(auto& entry : std::filesystem::directory_iterator(IVG::PATH_IMAGE_FILE.parent_path())) {
-		// Test that file is real file not link, folder, etc. and check it is a supported image format
-		if (std::filesystem::is_regular_file(entry) && (IVUTIL::formatSupport(entry.path().extension().string()) >= 0)) {
-			// Add file to list of images
-			IVG::FILES_IMAGES_ADJACENT.push_back(entry.path());
-			// If this is the image currently open, record position
-			if (entry.path() == IVG::PATH_IMAGE_FILE) IVG::INDEX_IMAGE_FILE = pos;
-			pos++;
-		}
-	}
+	// Index the image folder in the last used order, starting at the open image.
+	// The rest of the folder is read in the background and arrives as EVENT_FOLDER, as do later changes to it.
+	IVG::FOLDER.reset(new IVFolderIndex(IVG::EVENT_FOLDER));
+	if (IVG::SETTINGS.SORT_ORDER >= IVFolderIndex::ORDER_COUNT) IVG::SETTINGS.SORT_ORDER = IVFolderIndex::ORDER_NAME;
+	IVG::FOLDER->sort_order = (IVFolderIndex::order) IVG::SETTINGS.SORT_ORDER;
+	IVG::FOLDER->load(IVG::PATH_IMAGE_FILE);
 
-	std::cout << IVUTIL::LOG_NOTICE << "Found " << IVG::FILES_IMAGES_ADJACENT.size() << " images adjacent." << std::endl;
+	// Thumbnails of the neighbours, made in the background and kept on disk for next time
+	IVG::THUMBNAILS.reset(new IVThumbnailCache(IVG::PATH_PROGRAM_CWD / IVC::FILENAME_THUMBNAILS, IVG::EVENT_THUMBNAIL));
+	IVG::FILMSTRIP.reset(new IVFilmstrip(win.renderer, IVG::THUMBNAILS.get()));
+	IVG::FILMSTRIP->shown = IVG::SETTINGS.FILMSTRIP;
 
 	int mouseX;
 	int mouseY;
@@ -404,18 +636,31 @@ int main(int argc, char* argv[]) {
 	bool redraw = false;
 
 	/* IMPROVE FRAMERATE MANAGEMENT:
-		Rather than using a constant delay and relying on SDL's renderer vsync,
-		manage time tracking here. Enables higher and more consistent frame rates.
+		Rather than waking at a fixed rate, sleep until there is an event to handle or an animation
+		frame is due. Draws are still capped at the display refresh rate, since there is no vsync to rely on.
 	*/
-	std::chrono::steady_clock::time_point time_before = std::chrono::steady_clock::now();
-	std::chrono::steady_clock::time_point time_after = std::chrono::steady_clock::now();
-	int baseline_delay = 1000/(float) IVG::REFRESH_RATE;
-	int execution_time = 0;
+	std::chrono::steady_clock::time_point last_draw = std::chrono::steady_clock::now();
+	std::chrono::milliseconds baseline_delay((int) (1000/(float) IVG::REFRESH_RATE));
+
+	/* SUSPEND WHILE UNSEEN:
+		While the window is minimized or hidden nothing is drawn, and the folder's changes wait until it's back.
+		While the image is also panned out of view, animations aren't stepped. Their clock keeps running regardless,
+		so playback resumes on the frame it would have reached.
+	*/
+	bool visible = true;
+	bool suspended = false;
+	bool deferred_current = false;	// the current file changed on disk while hidden
+	bool deferred_order = false;	// the folder changed while hidden
 
 	// While application is running
 	while (!quit) {
-		// Handle events on queue
-		while (SDL_PollEvent(&sdlEvent) != 0) {
+		// Nothing changes on screen until the next event, animation frame or a held back redraw
+		bool unseen = !visible || !imageInView(&win);
+		std::chrono::steady_clock::time_point wake = (IVG::IMAGE_CURRENT && !unseen) ? IVG::IMAGE_CURRENT->deadline() : std::chrono::steady_clock::time_point::max();
+		if (redraw && visible) wake = std::min(wake, last_draw + baseline_delay);
+
+		// Handle the event that woke us, then anything else on the queue
+		for (bool pending = waitEvent(&sdlEvent, wake); pending; pending = SDL_PollEvent(&sdlEvent)) {
 			switch (sdlEvent.type) {
 				case SDL_QUIT:
 					quit = true;
@@ -433,10 +678,24 @@ int main(int argc, char* argv[]) {
 						case SDL_WINDOWEVENT_MAXIMIZED:
 							IVG::WIN_MOVED = false;
 							IVG::SETTINGS.MAXIMIZED = true;
+							visible = true;
+							redraw = true;
+							break;
+						case SDL_WINDOWEVENT_MINIMIZED:
+						case SDL_WINDOWEVENT_HIDDEN:
+							visible = false;
+							break;
+						case SDL_WINDOWEVENT_RESTORED:
+						case SDL_WINDOWEVENT_SHOWN:
+						case SDL_WINDOWEVENT_EXPOSED:
+							visible = true;
+							redraw = true;
 							break;
 						case SDL_WINDOWEVENT_SIZE_CHANGED:
 							IVG::SETTINGS.MAXIMIZED = false;
 							win.updateWindowSize();
+							IVStaticImage::target_w = win.w;
+							IVStaticImage::target_h = win.h;
 							redraw = true;
 							break;
 					}
@@ -444,7 +703,7 @@ int main(int argc, char* argv[]) {
 				case SDL_KEYDOWN:
 					switch (sdlEvent.key.keysym.sym) {
 						case SDLK_SPACE:	//if gif, toggle pause/play
-							if (IVG::IMAGE_CURRENT->animated) IVG::IMAGE_CURRENT->set_status(IVImage::STATE_TOGGLE);
+							if (IVG::IMAGE_CURRENT && IVG::IMAGE_CURRENT->animated) IVG::IMAGE_CURRENT->set_status(IVImage::STATE_TOGGLE);
 							break;
 						case SDLK_EQUALS:  //equals with plus secondary
 						case SDLK_KP_PLUS: //or keypad plus, zoom in
@@ -469,10 +728,10 @@ int main(int argc, char* argv[]) {
 							break;
 						case SDLK_F2: { // explorer's properties dialog
 							SHELLEXECUTEINFO sei;
-							size_t path_size = (std::filesystem::canonical(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]).string().length() + 1);
+							size_t path_size = (IVG::FOLDER->get().string().length() + 1);
 							char* new_path = (char *) malloc(path_size);
 
-							memcpy(new_path, std::filesystem::canonical(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]).string().c_str(), path_size);
+							memcpy(new_path, IVG::FOLDER->get().string().c_str(), path_size);
 							memset(&sei, 0, sizeof(SHELLEXECUTEINFO));
 
 							sei.cbSize = sizeof(SHELLEXECUTEINFO);
@@ -486,64 +745,67 @@ int main(int argc, char* argv[]) {
 							} break;
 						case SDLK_F3: { // open file's containing folder
 							// this could also be done with SHOpenFolderAndSelectItems but the setup and code required for that is extensive
-							std::string function = "/select,\"" + std::filesystem::canonical(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]).string() + "\"";
+							std::string function = "/select,\"" + IVG::FOLDER->get().string() + "\"";
 							ShellExecuteA(nullptr, "open", "explorer.exe", function.c_str(), nullptr, SW_SHOWNORMAL);
 							} break;
 						case SDLK_F5: //reload image
-							if (loadTextureFromFile(win.renderer, std::filesystem::canonical(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]))) { //if call returned non-zero, there was an error
-								std::cerr << IVUTIL::LOG_ERROR << IMG_GetError() << std::endl;
-								break;
-							}
+							IVG::IMAGE_CACHE.evict(IVG::FOLDER->get());
+							IVG::PREFETCH_FAILED.erase(IVG::FOLDER->get().string());
+							requestImage(IVG::FOLDER->get());
+							redraw = true;
+							break;
+						case SDLK_s: //cycle sort order, the current image stays put
+							IVG::SETTINGS.SORT_ORDER = (IVG::SETTINGS.SORT_ORDER + 1) % IVFolderIndex::ORDER_COUNT;
+							IVG::FOLDER->sort((IVFolderIndex::order) IVG::SETTINGS.SORT_ORDER);
+							std::cout << IVUTIL::LOG_NOTICE << "Sorting by " << IVC::SORT_NAMES[IVG::SETTINGS.SORT_ORDER] << std::endl;
+							prefetchQueue();
+							break;
+						case SDLK_f: //toggle filmstrip
+							IVG::SETTINGS.FILMSTRIP = !IVG::SETTINGS.FILMSTRIP;
+							IVG::FILMSTRIP->shown = IVG::SETTINGS.FILMSTRIP;
 							redraw = true;
 							break;
 						case SDLK_TAB: //toggle light mode
 							IVG::SETTINGS.DISPLAY_MODE_DARK = !IVG::SETTINGS.DISPLAY_MODE_DARK;
+							//only one theme's checkerboard is kept at a time
+							if (IVG::SETTINGS.DISPLAY_MODE_DARK) TEXTURE_LIGHT.release();
+							else TEXTURE_DARK.release();
 							redraw = true;
 							break;
 						case SDLK_DELETE: //delete image
 							if (IDYES == MessageBox(nullptr, "Are you sure you want to permanently delete this image?\nThis action cannot be reversed!", "Delete Image", MB_YESNO | MB_DEFBUTTON2 | MB_ICONEXCLAMATION)) {
 								try { //success
-									std::filesystem::remove(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]);
-									std::cout << IVUTIL::LOG_NOTICE << "File deleted: " << IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE].string() << std::endl;
+									IVG::IMAGE_CACHE.evict(IVG::FOLDER->get());
+									std::filesystem::remove(IVG::FOLDER->get());
+									std::cout << IVUTIL::LOG_NOTICE << "File deleted: " << IVG::FOLDER->get().string() << std::endl;
 								}
 								catch (const std::filesystem::filesystem_error& e) { //failure
-									std::cerr << IVUTIL::LOG_WARNING << "File could not be deleted: " << IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE].string() << std::endl;
+									std::cerr << IVUTIL::LOG_WARNING << "File could not be deleted: " << IVG::FOLDER->get().string() << std::endl;
 									std::cerr << IVUTIL::LOG_WARNING << e.what() << std::endl;
 									MessageBox(nullptr, "Image could not be deleted.", "Image Deletion Failure", MB_OK | MB_ICONERROR);
 									break;
 								}
-								IVG::FILES_IMAGES_ADJACENT.erase(IVG::FILES_IMAGES_ADJACENT.begin() + IVG::INDEX_IMAGE_FILE);
-								IVG::INDEX_IMAGE_FILE--;
-								SDL_Event sdlENext;
-								sdlENext.type = SDL_KEYDOWN;
-								sdlENext.key.keysym.sym = SDLK_RIGHT;
-								SDL_PushEvent(&sdlENext);
+								// moves on to the next image
+								IVG::FOLDER->remove();
+								IVG::NAVIGATION_DIRECTION = 1;
+								showCurrent(&win);
+								redraw = true;
 							}
 							break;
 						//previous image
 						case SDLK_LEFT: //move back
-							if (IVG::FILES_IMAGES_ADJACENT.size() == 1) break; //there's only one image in the folder so don't move
-							if (IVG::INDEX_IMAGE_FILE == 0) IVG::INDEX_IMAGE_FILE = IVG::FILES_IMAGES_ADJACENT.size() - 1; //loop back to end of image file list
-							else IVG::INDEX_IMAGE_FILE--;
-							win.setTitle((IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE].filename().string() + " - " + IVUTIL::APPLICATION_TITLE).c_str()); //update window title
-							if (loadTextureFromFile(win.renderer, std::filesystem::canonical(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]))) { //if call returned non-zero, there was an error
-								std::cerr << IVUTIL::LOG_ERROR << IMG_GetError() << std::endl;
-								break;
-							}
-							resetViewport(); //new image so reset zoom and positioning
+							if (IVG::FOLDER->size() <= 1) break; //there's only one image in the folder so don't move
+							IVG::FOLDER->move(-1); //wraps around to the end of the folder
+							IVG::NAVIGATION_DIRECTION = -1;
+							showCurrent(&win);
 							redraw = true;
 							break;
 						//next image
 						case SDLK_RIGHT: //move forward
-							if (IVG::FILES_IMAGES_ADJACENT.size() == 1) break; //there's only one image in the folder so don't move
-							IVG::INDEX_IMAGE_FILE++;
-							if (IVG::INDEX_IMAGE_FILE >= IVG::FILES_IMAGES_ADJACENT.size()) IVG::INDEX_IMAGE_FILE = 0; //loop back to start of image file list
-							win.setTitle((IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE].filename().string() + " - " + IVUTIL::APPLICATION_TITLE).c_str()); //update window title
-							if (loadTextureFromFile(win.renderer, std::filesystem::canonical(IVG::FILES_IMAGES_ADJACENT[IVG::INDEX_IMAGE_FILE]))) { //if call returned non-zero, there was an error
-								std::cerr << IVUTIL::LOG_ERROR << IMG_GetError() << std::endl;
-								break;
-							}
-							resetViewport(); //new image so reset zoom and positioning
+							if (IVG::FOLDER->size() <= 1) break; //there's only one image in the folder so don't move
+							IVG::FOLDER->move(1); //wraps around to the start of the folder
+							IVG::NAVIGATION_DIRECTION = 1;
+							showCurrent(&win);
 							redraw = true;
 							break;
 					}
@@ -572,10 +834,20 @@ int main(int argc, char* argv[]) {
 					break;
 				case SDL_MOUSEBUTTONDOWN:
 					switch (sdlEvent.button.button) {
-						case SDL_BUTTON_LEFT:
+						case SDL_BUTTON_LEFT: {
+							// clicking a thumbnail jumps to it instead of starting a pan
+							int steps;
+							if (IVG::FILMSTRIP->hit(&win, sdlEvent.button.x, sdlEvent.button.y, &steps)) {
+								if (!steps) break;
+								IVG::FOLDER->move(steps);
+								IVG::NAVIGATION_DIRECTION = (steps < 0) ? -1 : 1;
+								showCurrent(&win);
+								redraw = true;
+								break;
+							}
 							IVG::MOUSE_CLICK_STATE_LEFT = true;
 							SDL_GetMouseState(&mouseX, &mouseY);
-							break;
+							} break;
 						case SDL_BUTTON_MIDDLE:
 							resetViewport();
 							redraw = true;
@@ -618,31 +890,95 @@ int main(int argc, char* argv[]) {
 					}
 					break;
 				default:
+					// a background decode finished
+					if (sdlEvent.type == IVG::EVENT_DECODED) {
+						int received = receiveDecoded(win.renderer);
+						if (received < 0 && !IVG::IMAGE_CURRENT) { // the image passed in couldn't be loaded
+							MessageBox(nullptr, "Please verify the file is not corrupt or misformed.",
+												"Could not load image!", MB_OK | MB_ICONERROR);
+							quit = true;
+						}
+						if (received > 0) redraw = true;
+					}
+					// more of the folder was read, it changed on disk or a background sort finished
+					else if (sdlEvent.type == IVG::EVENT_FOLDER) {
+						IVFolderIndex::update changes = IVG::FOLDER->collect();
+
+						for (auto& path : changes.stale) {
+							IVG::IMAGE_CACHE.evict(path);
+							IVG::PREFETCH_FAILED.erase(path.string());
+							IVG::FILMSTRIP->forget(path);
+						}
+						if (changes.enumerated) {
+							std::cout << IVUTIL::LOG_NOTICE << "Found " << IVG::FOLDER->size() << " images adjacent." << std::endl;
+						}
+
+						// nobody is looking, so a camera writing to the folder doesn't cause a decode per shot
+						if (!visible) {
+							deferred_current |= changes.current;
+							deferred_order |= changes.order;
+						}
+						else if (changes.current) {
+							reloadCurrent(&win);
+							redraw = true;
+						}
+						else if (changes.order) prefetchQueue();
+						// the strip shows the neighbours too
+						if (changes.order && IVG::FILMSTRIP->shown) redraw = true;
+					}
+					// background thumbnails are ready
+					else if (sdlEvent.type == IVG::EVENT_THUMBNAIL) {
+						if (IVG::FILMSTRIP->collect() && IVG::FILMSTRIP->shown) redraw = true;
+					}
 					break;
 			}
 		}
 
-		if (IVG::IMAGE_CURRENT->animated && IVG::IMAGE_CURRENT->ready) {
-			IVG::IMAGE_CURRENT->prepare();
+		// Back in view, so catch up with whatever happened to the folder in the meantime
+		if (visible && (deferred_current || deferred_order)) {
+			if (deferred_current) reloadCurrent(&win);
+			else prefetchQueue();
+			deferred_current = deferred_order = false;
 			redraw = true;
 		}
 
-		// If something happened that requires a redraw, process it
-		if (redraw) {
-			redraw = false;
-			draw(&win, (IVG::SETTINGS.DISPLAY_MODE_DARK) ? &TEXTURE_DARK : &TEXTURE_LIGHT, IVG::IMAGE_CURRENT->texture);
+		// Animations are stepped against the clock here, late frames are dropped rather than slowing playback down.
+		// Coming back from being unseen jumps straight to the frame due now, however long that was.
+		unseen = !visible || !imageInView(&win);
+		if (IVG::IMAGE_CURRENT && !unseen) {
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (suspended ? IVG::IMAGE_CURRENT->seek(now) : IVG::IMAGE_CURRENT->advance(now)) {
+				IVTRACE_SCOPE("frame");
+				IVG::IMAGE_CURRENT->prepare();
+				redraw = true;
+			}
 		}
+		suspended = unseen;
 
-		// Track the amount of time if took to run loop and subtract it from time per frame to match refresh rate
-		time_after = std::chrono::steady_clock::now();
-		execution_time = std::chrono::duration_cast<std::chrono::milliseconds>(time_after - time_before).count();
-		SDL_Delay(std::max(0, baseline_delay - execution_time));
-		time_before = std::chrono::steady_clock::now();
-
+		// If something happened that requires a redraw, process it (unless the last draw was too recent, then it waits)
+		if (redraw && visible && std::chrono::steady_clock::now() >= last_draw + baseline_delay) {
+			redraw = false;
+			upgradeCurrent(&win);
+			draw(&win, (IVG::SETTINGS.DISPLAY_MODE_DARK) ? &TEXTURE_DARK : &TEXTURE_LIGHT, IVG::IMAGE_CURRENT.get());
+			last_draw = std::chrono::steady_clock::now();
+		}
 	}
 
 	pushSettings(&win);
 	IVUTIL::writeSettings(IVG::PATH_PROGRAM_CWD / IVC::FILENAME_SETTINGS, &IVG::SETTINGS);
 
+	// Stop the workers and release textures while the renderer still exists
+	IVG::DECODER.reset();
+	IVG::FILMSTRIP.reset();
+	IVG::THUMBNAILS.reset();
+	IVG::FOLDER.reset();
+	IVG::IMAGE_CACHE.clear();
+	IVG::IMAGE_CURRENT.reset();
+	IVG::COMPOSITOR.reset();
+
+	if (traceArgument && !IVTRACE::stop()) {
+		std::cerr << IVUTIL::LOG_WARNING << "Could not write trace to \'" << traceArgument << "\'" << std::endl;
+	}
+
 	return 0;
 }
@@ -5,6 +5,10 @@ NICK WILSON
 */
 
 #include "IVAnimatedImage.hpp"
+#include "IVRender.hpp"
+
+#include <cstring>		//memcpy
+#include <algorithm>	//min
 
 /* PRIVATE */
 
@@ -19,8 +23,8 @@ void IVAnimatedImage::setPalette(ColorMapObject* colorMap, SDL_Surface* surface)
 
 	// this long, stupid conversion required as SDL *REQUIRES* an alpha channel
 	for (int i = 0; i < colorMap->ColorCount; i++) {
-		//create corresponding SDL_Color
-		SDL_Color sc = {gc[0], gc[1], gc[2], 0};
+		//create corresponding SDL_Color, opaque as the canvas has an alpha channel that blits copy it into
+		SDL_Color sc = {gc[0], gc[1], gc[2], SDL_ALPHA_OPAQUE};
 		//set palette with new colour
 		SDL_SetPaletteColors(surface->format->palette, &sc, i, 1);
 		// move along to next colour
@@ -32,19 +36,29 @@ void IVAnimatedImage::setPalette(ColorMapObject* colorMap, SDL_Surface* surface)
 * setIndex	- Set frame index record to provided index with boundaries checked
 * index 	> New frame index
 */
-void IVAnimatedImage::setIndex(uint16_t index) {
-	this->frame_index = index;
-	this->frame_index %= this->frame_count;
+void IVAnimatedImage::setIndex(uint32_t index) {
+	// a streamed file's length isn't known until it has been read through once
+	if (this->stream) this->frame_count = this->stream->frame_count;
+	this->frame_index = this->frame_count ? index % this->frame_count : index;
 }
 
 /**
 * getDelay	- Load extension chunks related to provided image index and search for a delay value
 * index 	> Target frame index
 */
-uint16_t IVAnimatedImage::getDelay(uint16_t index) {
+uint16_t IVAnimatedImage::getDelay(uint32_t index) {
+	if (this->stream) {
+		// the reader records delays as it goes, so there's no need to wait on the frame itself
+		uint16_t delay;
+		if (this->stream->delay(index, &delay)) {
+			this->delay_val = std::max((uint16_t) GIF_MIN_DELAY, delay);
+		}
+		return this->delay_val;
+	}
+
 	index %= frame_count;
 	//call search for graphics block
-	ExtensionBlock* gfx = getGraphicsBlock(index);
+	ExtensionBlock* gfx = getGraphicsBlock(&this->gif_data->SavedImages[index]);
 	//if one was found, update delay
 	if (gfx) {
 		// delay is bounded by somewhat standard lower limit of 0.02 seconds per frame
@@ -61,71 +75,157 @@ uint16_t IVAnimatedImage::getDelay() {
 }
 
 /**
-* getGraphicsBlock 	- Locate and return the Extension Block of type Graphics Control for provided index
-* index 			> Target frame index
+* getFrame 		- Locate the decoded data for a frame, waiting for the reader if the file is being streamed
+* index 		> Target frame index
+* return - ptr 	< Frame data, or nullptr if it could not be read
 */
-ExtensionBlock* IVAnimatedImage::getGraphicsBlock(uint16_t index) {
+SavedImage* IVAnimatedImage::getFrame(uint32_t index) {
+	if (this->stream) return this->stream->acquire(index);
+	return &this->gif_data->SavedImages[index % this->frame_count];
+}
+
+/**
+* getGraphicsBlock 	- Locate and return the Extension Block of type Graphics Control for provided frame
+* frame 			> Target frame
+*/
+ExtensionBlock* IVAnimatedImage::getGraphicsBlock(SavedImage* frame) {
 	// iterate and look for graphics extension with timing data
-	for (int i = 0; i < gif_data->SavedImages[index].ExtensionBlockCount; i++) {
-		if (gif_data->SavedImages[index].ExtensionBlocks[i].Function == GRAPHICS_EXT_FUNC_CODE) { // found it
-			return &gif_data->SavedImages[index].ExtensionBlocks[i];
+	for (int i = 0; i < frame->ExtensionBlockCount; i++) {
+		if (frame->ExtensionBlocks[i].Function == GRAPHICS_EXT_FUNC_CODE) { // found it
+			return &frame->ExtensionBlocks[i];
 		}
 	}
 	return nullptr;
 }
 
 /**
-* animate - The function is called as a thread and will advance the index and manage timing for the animation automatically.
-*			If the status is set to paused, it will wait before continuing to animate.
+* following	- Index of the frame after the provided one, wrapping once the frame count is known
+* index 	> Current frame index
 */
-void IVAnimatedImage::animate() {
-	while(!this->quit) {
-		while (!this->play) {
-			if (this->quit) return; //make it possible to break out for quitting while paused
-			SDL_Delay(30);
-		}
-		setIndex(this->frame_index + 1); 	//advance by a frame
-		this->ready = true;					//mark frame as ready to be prepare()'d
-		getDelay();
-		SDL_Delay(this->delay_val * 10);	//wait (gif resolution is only 1/100 of a sec, mult. by 10 for millis)
-	}
-	return;
+uint32_t IVAnimatedImage::following(uint32_t index) {
+	// the producer calls this too, so a streamed file's count is read from the stream rather than the copy setIndex() keeps
+	uint32_t count = (this->stream) ? (uint32_t) this->stream->frame_count : this->frame_count;
+	return (count) ? (index + 1) % count : index + 1;
 }
 
+/**
+* prerender - Spend GIF_PRERENDER_BUDGET on getting frames ready ahead of time. If every frame fits, each becomes its own
+*			  texture up front and playing is only a matter of picking one. Otherwise frames are played through a single
+*			  streaming texture, and a producer thread composites up to GIF_RING_FRAMES of them ahead of the play head
+*			  so prepare() only copies in the region each one changed. If not even two frames fit, there's no producer
+*			  and prepare() composites on the fly.
+*/
 void IVAnimatedImage::prerender() {
-	for (int i = 0; i < this->frame_count; i++) {
-		prepare(i);
-		this->frames.push_back(this->texture);
-		this->texture = nullptr; //remove reference so next call to prepare doesn't free it
+	size_t frame_bytes = (size_t) this->w * this->h * 4;
+
+	if (!this->stream && frame_bytes * this->frame_count <= GIF_PRERENDER_BUDGET) {
+		for (uint32_t i = 0; i < this->frame_count; i++) {
+			prepare(i);
+			this->frames.push_back(this->texture);
+			this->texture = nullptr; //remove reference so next call to prepare doesn't free it
+		}
+		this->texture = this->frames[0];
+		return;
 	}
-	return;
+
+	// the first frame goes straight to a streaming texture, the canvas is the producer's from then on
+	this->prerendered = false;
+	prepare(0);
+
+	this->ring_capacity = std::min((size_t) GIF_RING_FRAMES, GIF_PRERENDER_BUDGET / frame_bytes);
+	if (this->ring_capacity < 2) {
+		this->ring_capacity = 0;
+		return;
+	}
+	this->producer = std::thread(&IVAnimatedImage::produce, this, following(0));
 }
 
 /* PUBLIC */
 
-IVAnimatedImage::IVAnimatedImage(SDL_Renderer* renderer, std::filesystem::path path) {
-	gif_data = DGifOpenFileName(path.string().c_str(), nullptr);
+IVAnimatedImage::IVAnimatedImage(std::filesystem::path path) {
+	this->path = path;
+}
 
-	// Will be null if image metadata could not be read
-	if (!gif_data) {
-		throw IVUTIL::EXCEPT_IMG_OPEN_FAIL;
+IVAnimatedImage::IVAnimatedImage(SDL_Renderer* renderer, std::filesystem::path path) : IVAnimatedImage(path) {
+	decode();
+	upload(renderer);
+}
+
+IVAnimatedImage::~IVAnimatedImage() {
+	// the producer may be reading from the stream and writing to the canvas
+	if (this->producer.joinable()) {
+		{
+			std::lock_guard<std::mutex> hold(this->ring_lock);
+			this->stopping = true;
+		}
+		this->ring_space.notify_all();
+		this->producer.join();
 	}
 
-	// Will return GIF_ERROR if gif data structure cannot be populated
-	if (DGifSlurp(gif_data) == GIF_ERROR) {
-		throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+	delete this->stream;
+	DGifCloseFile(this->gif_data, nullptr);
+	SDL_FreeSurface(this->surface);
+	for (uint32_t i = 0; i < this->frames.size(); i++) {
+		SDL_DestroyTexture(this->frames[i]);
+	}
+	// otherwise texture is one of the above
+	if (this->frames.empty()) {
+		SDL_DestroyTexture(this->texture);
 	}
+}
 
-	this->animated = (gif_data->ImageCount > 1);
-	this->renderer = renderer;
-	this->w = gif_data->SWidth;
-	this->h = gif_data->SHeight;
+/**
+* decode - Read the file into memory, or for large files start reading it in the background.
+*		   Touches no renderer state, so it can run on a worker thread.
+*/
+void IVAnimatedImage::decode() {
+	std::error_code error;
+	uintmax_t size = std::filesystem::file_size(path, error);
 
-	this->frame_count = gif_data->ImageCount;
+	if (!error && size > GIF_STREAM_THRESHOLD) {
+		// too big to hold every frame, decode just ahead of playback instead
+		this->stream = new IVGifStream(path);
 
-	if (gif_data->SColorMap) {
+		// frame 0 is all that's needed to show something
+		if (!this->stream->acquire(0)) {
+			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+		}
+
+		this->animated = this->stream->multiple();
+		this->w = this->stream->w;
+		this->h = this->stream->h;
+		this->global_map = this->stream->colours;
+	}
+	else {
+		// everything is copied out by DGifSlurp, so the mapping is only needed until then
+		IVGifSource source;
+		{
+			IVTRACE_SCOPE("open");
+			if (source.map(path)) gif_data = source.open();
+		}
+
+		// Will be null if image metadata could not be read
+		if (!gif_data) {
+			throw IVUTIL::EXCEPT_IMG_OPEN_FAIL;
+		}
+
+		// Will return GIF_ERROR if gif data structure cannot be populated
+		IVTRACE_SCOPE("read");
+		if (DGifSlurp(gif_data) == GIF_ERROR || gif_data->ImageCount < 1) {
+			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+		}
+
+		this->animated = (gif_data->ImageCount > 1);
+		this->w = gif_data->SWidth;
+		this->h = gif_data->SHeight;
+
+		this->frame_count = gif_data->ImageCount;
+		this->global_map = gif_data->SColorMap;
+	}
+
+	if (this->global_map) {
 		// NOTE: IN BITS
-		this->depth = gif_data->SColorMap->BitsPerPixel;
+		this->depth = this->global_map->BitsPerPixel;
 
 		/* I came across an example gif which was reported as 6 BPP by giflib.		*/
 		/* However, Windows reported it as 8 BPP and when set as 8 BPP, it loaded.	*/
@@ -138,80 +238,76 @@ IVAnimatedImage::IVAnimatedImage(SDL_Renderer* renderer, std::filesystem::path p
 		// No global palette, assume 8 BPP depth
 		this->depth = 8;
 	}
-	
-
-	// Create surface with existing gif data. 8 bit depth will trigger automatic creation of palette to be filled next
-	this->surface = SDL_CreateRGBSurfaceFrom((void *) gif_data->SavedImages[0].RasterBits, this->w, this->h, this->depth, this->w * (this->depth >> 3), 0, 0, 0, 0);
-
-	if (gif_data->SColorMap) { // if global colour palette defined
-		// convert from global giflib colour to SDL colour and populate palette
-		setPalette(gif_data->SColorMap, this->surface);
-	}
-	else if (gif_data->SavedImages[this->frame_index].ImageDesc.ColorMap) { // local colour palette
-		// convert from local giflib colour to SDL colour and populate palette
-		setPalette(gif_data->SavedImages[this->frame_index].ImageDesc.ColorMap, this->surface);
-	}
-
-	/* Convert to a more friendly format */
-	SDL_PixelFormat *format = SDL_AllocFormat(SDL_PIXELFORMAT_RGB888);
-	SDL_Surface *output = SDL_ConvertSurface(surface, format, 0);
-	SDL_FreeFormat(format);
-	SDL_FreeSurface(surface);
-	surface = output;
+}
 
-	this->texture = SDL_CreateTextureFromSurface(this->renderer, this->surface);
+/**
+* upload	- Build the first frame (and every other frame when prerendering) as textures, then start playback
+* renderer	> Target SDL_Renderer
+*/
+void IVAnimatedImage::upload(SDL_Renderer* renderer) {
+	if ((!this->gif_data && !this->stream) || this->surface) return;
 
-	if (this->animated) {
-		if (this->prerendered) prerender();
-		animationThread = std::thread(&IVAnimatedImage::animate, this);
-	}
-}
+	this->renderer = renderer;
+	// IVCompositor draws from the canvas itself, so there are no frames to prerender
+	if (keep_pixels) this->prerendered = false;
 
-IVAnimatedImage::~IVAnimatedImage() {
-	if (this->animated) {
-		this->quit = true;
-		animationThread.join();
+	// Canvas that every frame is composited on to, as frames may only cover part of it.
+	// It's in the renderer's own format so frames are copied to textures unconverted
+	this->surface = SDL_CreateRGBSurfaceWithFormat(0, this->w, this->h, 32, texture_format);
+	if (!this->surface) {
+		throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
 	}
-	DGifCloseFile(this->gif_data, nullptr);
-	SDL_FreeSurface(this->surface);
-	if (prerendered) {
-		for (uint32_t i = 0; i < this->frames.size(); i++) {
-			SDL_DestroyTexture(this->frames[i]);
+	// transparent pixels show the canvas, and every texture made from it is drawn without blending
+	this->opaque = true;
+
+	if (this->global_map) {
+		int bg = (this->stream) ? this->stream->background : this->gif_data->SBackGroundColor;
+		if (bg < this->global_map->ColorCount) {
+			GifColorType* c = &this->global_map->Colors[bg];
+			SDL_FillRect(this->surface, nullptr, SDL_MapRGB(this->surface->format, c->Red, c->Green, c->Blue));
 		}
 	}
+
+	if (this->animated && this->prerendered) {
+		prerender();
+	}
 	else {
-		SDL_DestroyTexture(this->texture);
+		prepare(0);
 	}
 }
 
 /**
-* prepare - Create surface from specified index, apply palette and create texture, keying as required.
-*			This should be called as infrequently as possible - static images don't need refreshing.
+* composite 	- Create surface from specified index, apply palette and blit it on to the canvas, keying as required
+* index 		> Target frame index
+* dirty 		< Region of the canvas that changed, clipped to the canvas
+* return - bool	< False if the frame could not be read
 */
-void IVAnimatedImage::prepare(uint16_t index) {
+bool IVAnimatedImage::composite(uint32_t index, SDL_Rect* dirty) {
+	SavedImage* frame = getFrame(index);
+	if (!frame) return false;
+
 	// shortened for simplicity
-	GifImageDesc* im_desc = &this->gif_data->SavedImages[index].ImageDesc;
+	GifImageDesc* im_desc = &frame->ImageDesc;
 
 	// destination for copy - if only a region is being updated, this will not cover the whole image
-	SDL_Rect dest;
-	dest.x = im_desc->Left;
-	dest.y = im_desc->Top;
-	dest.w = im_desc->Width;
-	dest.h = im_desc->Height;
+	dirty->x = im_desc->Left;
+	dirty->y = im_desc->Top;
+	dirty->w = im_desc->Width;
+	dirty->h = im_desc->Height;
 
-	SDL_Surface* temp = SDL_CreateRGBSurfaceFrom((void *) this->gif_data->SavedImages[index].RasterBits, im_desc->Width, im_desc->Height, this->depth, im_desc->Width * (this->depth >> 3), 0, 0, 0, 0);
+	SDL_Surface* temp = SDL_CreateRGBSurfaceFrom((void *) frame->RasterBits, im_desc->Width, im_desc->Height, this->depth, im_desc->Width * (this->depth >> 3), 0, 0, 0, 0);
 
-	if (gif_data->SavedImages[index].ImageDesc.ColorMap) { // local colour palette
+	if (im_desc->ColorMap) { // local colour palette
 		// convert from local giflib colour to SDL colour and populate palette
-		setPalette(gif_data->SavedImages[index].ImageDesc.ColorMap, temp);
+		setPalette(im_desc->ColorMap, temp);
 	}
-	else if (gif_data->SColorMap) { // if global colour palette defined
+	else if (this->global_map) { // if global colour palette defined
 		// convert from global giflib colour to SDL colour and populate palette
-		setPalette(gif_data->SColorMap, temp);
+		setPalette(this->global_map, temp);
 	}
 
 	//get gfx extension block to find transparent palette index
-	ExtensionBlock* gfx = getGraphicsBlock(index);
+	ExtensionBlock* gfx = getGraphicsBlock(frame);
 
 	//if gfx block exists and transparency flag is set, set colour key
 	if (gfx && (gfx->Bytes[0] & 0x01)) {
@@ -219,47 +315,268 @@ void IVAnimatedImage::prepare(uint16_t index) {
 		SDL_SetColorKey(temp, SDL_TRUE, gfx->Bytes[3]);
 	}
 
-	// copy over region that is being updated, leaving anything else
-	SDL_BlitSurface(temp, nullptr, this->surface, &dest);
+	// copy over region that is being updated, leaving anything else (dirty is clipped to the canvas by SDL)
+	SDL_BlitSurface(temp, nullptr, this->surface, dirty);
 	SDL_FreeSurface(temp);
+	return true;
+}
+
+/**
+* produce 	- Producer thread body: composite frames on to the canvas ahead of the play head and queue the region each
+*			  one changed, until the ring holds ring_capacity of them. Wakes the main loop if prepare() ran out.
+* index 	> First frame to composite, the one after what the texture shows
+*/
+void IVAnimatedImage::produce(uint32_t index) {
+	while (true) {
+		{
+			std::unique_lock<std::mutex> hold(this->ring_lock);
+			this->ring_space.wait(hold, [this] { return this->stopping || this->ring.size() < this->ring_capacity; });
+			if (this->stopping) return;
+		}
+
+		SDL_Rect dirty;
+		if (!composite(index, &dirty)) return;
+
+		// the canvas is 32 BPP, only the rows and columns that changed are kept
+		rendered entry = {index, dirty, {}};
+		if (dirty.w > 0 && dirty.h > 0) {
+			entry.pixels.resize((size_t) dirty.w * dirty.h * 4);
+			for (int y = 0; y < dirty.h; y++) {
+				memcpy(entry.pixels.data() + (size_t) y * dirty.w * 4, (uint8_t*) this->surface->pixels + (size_t) (dirty.y + y) * this->surface->pitch + (size_t) dirty.x * 4, (size_t) dirty.w * 4);
+			}
+		}
+		index = following(index);
 
-	SDL_DestroyTexture(this->texture); //delete old texture
-	this->texture = SDL_CreateTextureFromSurface(this->renderer, this->surface);
+		std::lock_guard<std::mutex> hold(this->ring_lock);
+		this->ring.push_back(std::move(entry));
+		if (this->starved) notify();
+	}
+}
+
+/**
+* update 	- Copy a region into the streaming texture
+* area 		> Region of the texture
+* pixels 	> 32 BPP pixels for it, in the texture's format
+* pitch 	> Bytes from one row of pixels to the next
+*/
+void IVAnimatedImage::update(const SDL_Rect* area, const uint8_t* pixels, int pitch) {
+	void* locked;
+	int locked_pitch;
+	if (!this->texture || area->w <= 0 || area->h <= 0 || SDL_LockTexture(this->texture, area, &locked, &locked_pitch)) return;
 
-	this->ready = false; 	// mark current frame as already requested
+	for (int y = 0; y < area->h; y++) {
+		memcpy((uint8_t*) locked + (size_t) y * locked_pitch, pixels + (size_t) y * pitch, (size_t) area->w * 4);
+	}
+	SDL_UnlockTexture(this->texture);
 }
 
 /**
-* prepare - If in prerender mode, update index. Otherwise, prepare current index frame.
+* present	- Make the canvas visible. When prerendering this creates a new texture,
+*			  otherwise only the changed region of the existing one is updated. With keep_pixels the canvas is all there is.
+* dirty 	> Region of the canvas changed since the last call
+*/
+void IVAnimatedImage::present(SDL_Rect* dirty) {
+	if (keep_pixels) return;
+
+	if (this->prerendered) {
+		// every frame gets its own texture, prerender() takes ownership of it
+		SDL_DestroyTexture(this->texture); //delete old texture
+		this->texture = IVRENDER::createTexture(this->renderer, this->surface, SDL_TEXTUREACCESS_STATIC);
+		return;
+	}
+
+	// one texture for the life of the image, only the region that changed is sent
+	SDL_Rect dest = *dirty;
+	if (!this->texture) {
+		this->texture = SDL_CreateTexture(this->renderer, this->surface->format->format, SDL_TEXTUREACCESS_STREAMING, this->w, this->h);
+		if (this->texture) SDL_SetTextureBlendMode(this->texture, SDL_BLENDMODE_NONE);
+		dest = {0, 0, this->w, this->h};
+	}
+
+	// same format on both sides, so the changed rows are copied straight into the locked texture
+	update(&dest, (uint8_t*) this->surface->pixels + (size_t) dest.y * this->surface->pitch + (size_t) dest.x * 4, this->surface->pitch);
+}
+
+/**
+* prepare - Composite the specified frame on to the canvas and show it.
+*			This should be called as infrequently as possible - static images don't need refreshing.
+*/
+void IVAnimatedImage::prepare(uint32_t index) {
+	SDL_Rect dirty;
+	if (!composite(index, &dirty)) return;
+
+	this->composited = index;
+	present(&dirty);
+}
+
+/**
+* prepare - Show the current frame: from the prerendered textures if there are any, from what the producer has ready,
+*			otherwise by compositing it. Frames skipped by advance() are applied too, as later frames may only cover part of the canvas.
 */
 void IVAnimatedImage::prepare() {
-	if (prerendered) {
+	SDL_Rect dirty;
+
+	if (this->ring_capacity) {
+		// a streamed file's first pass may have been composited before its length was known
+		auto at = [this](uint32_t index) { return (this->frame_count) ? index % this->frame_count : index; };
+
+		// every frame up to the play head is copied in order, as each may only change part of the canvas
+		std::unique_lock<std::mutex> hold(this->ring_lock);
+		while (at(this->composited) != this->frame_index && !this->ring.empty()) {
+			rendered entry = std::move(this->ring.front());
+			this->ring.pop_front();
+			hold.unlock();
+			update(&entry.dirty, entry.pixels.data(), entry.dirty.w * 4);
+			hold.lock();
+			this->composited = entry.index;
+		}
+		// the producer fell behind, it wakes the main loop when it catches up rather than this compositing here
+		this->starved = at(this->composited) != this->frame_index;
+		hold.unlock();
+		this->ring_space.notify_one();
+	}
+	else if (prerendered) {
 		this->texture = frames[frame_index];
-		this->ready = false;
 	}
 	else {
-		prepare(frame_index);
+		SDL_Rect changed = {0, 0, 0, 0};
+		while (this->composited != this->frame_index) {
+			uint32_t next = following(this->composited);
+			if (!composite(next, &dirty)) break;
+			this->composited = next;
+			SDL_UnionRect(&changed, &dirty, &changed);
+		}
+		present(&changed);
 	}
 }
 
+/**
+* pixels 				- The canvas, which always holds the current frame once prerendering is off
+* w, h 					> Size the image is drawn at, unused
+* return - SDL_Surface*	< Canvas surface, nullptr unless keep_pixels is set
+*/
+SDL_Surface* IVAnimatedImage::pixels([[maybe_unused]] int w, [[maybe_unused]] int h) {
+	return keep_pixels ? this->surface : nullptr;
+}
+
+/**
+* draw 			- Draw the current frame, or only the part of it inside the viewport when zoomed in
+* destination 	> Where the whole image is placed in the window
+* viewport 		> Visible area of the window
+*/
+void IVAnimatedImage::draw(SDL_Rect* destination, SDL_Rect* viewport) {
+	IVRENDER::copyClipped(this->renderer, this->texture, destination, viewport);
+}
+
+/**
+* bytes - The canvas and texture, plus every prerendered frame or a full ring of them
+*/
+size_t IVAnimatedImage::bytes() {
+	return (size_t) this->w * this->h * 4 * (2 + this->frames.size() + this->ring_capacity);
+}
+
+/**
+* advance 		- Step the animation to the frame due at the provided time.
+*				  Frames whose time has already passed are skipped so playback keeps to the clock.
+* now 			> Current time
+* return - bool	< True if the frame changed and prepare() should be called
+*/
+bool IVAnimatedImage::advance(std::chrono::steady_clock::time_point now) {
+	// the producer has caught up with a frame prepare() had to go without
+	if (this->starved) {
+		std::lock_guard<std::mutex> hold(this->ring_lock);
+		if (!this->ring.empty()) return true;
+	}
+
+	if (!this->animated || !this->play) return false;
+
+	if (!this->scheduled) {
+		// the first frame is shown from the first time we're asked
+		this->next_frame = now + std::chrono::milliseconds(getDelay() * 10);
+		this->scheduled = true;
+		return false;
+	}
+
+	if (now < this->next_frame) return false;
+
+	while (now >= this->next_frame) {
+		setIndex(this->frame_index + 1);
+		// gif resolution is only 1/100 of a sec, mult. by 10 for millis
+		this->next_frame += std::chrono::milliseconds(getDelay() * 10);
+
+		// too far behind (stalled, or asleep), start again from now rather than racing through frames
+		if (now - this->next_frame > std::chrono::milliseconds(GIF_MAX_LAG)) {
+			this->next_frame = now + std::chrono::milliseconds(getDelay() * 10);
+		}
+	}
+	return true;
+}
+
+/**
+* seek 			- Step the animation to the frame it would be showing had it played all along, however long it wasn't shown for.
+*				  Whole loops are skipped without visiting their frames, so at most one loop is stepped through.
+* now 			> Current time
+* return - bool	< True if the frame changed and prepare() should be called
+*/
+bool IVAnimatedImage::seek(std::chrono::steady_clock::time_point now) {
+	if (!this->animated || !this->play || !this->scheduled) return false;
+
+	// a streamed file's loop can't be timed until it has been read through once, so it just carries on from here
+	if (this->stream) this->frame_count = this->stream->frame_count;
+	if (!this->frame_count) return advance(now);
+	if (now < this->next_frame) return false;
+
+	std::chrono::milliseconds loop(0);
+	for (uint32_t i = 0; i < this->frame_count; i++) {
+		loop += std::chrono::milliseconds(getDelay(i) * 10);
+	}
+	this->next_frame += ((now - this->next_frame) / loop) * loop;
+
+	while (now >= this->next_frame) {
+		setIndex(this->frame_index + 1);
+		this->next_frame += std::chrono::milliseconds(getDelay() * 10);
+	}
+	return true;
+}
+
+/**
+* deadline - When the current frame's time is up, or never if the image is still or paused
+*/
+std::chrono::steady_clock::time_point IVAnimatedImage::deadline() {
+	if (!this->animated || !this->play) return std::chrono::steady_clock::time_point::max();
+	if (!this->scheduled) return std::chrono::steady_clock::time_point::min();
+	return this->next_frame;
+}
+
 /**
 * set_status 	- Set image state - play or pause (or toggle to swap)
 * s 			> New IVImage::state state
 */
 void IVAnimatedImage::set_status(state s) {
+	bool play = this->play;
 	switch (s) {
 		case STATE_PLAY:
-			this->play = true;
+			play = true;
 			break;
 		case STATE_PAUSE:
-			this->play = false;
+			play = false;
 			break;
 		case STATE_TOGGLE:
-			this->play = !this->play;
+			play = !this->play;
 			break;
 		default:
 			break;
 	}
+
+	if (play == this->play) return;
+
+	// keep what was left of the current frame so resuming doesn't skip or repeat time
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (this->scheduled) {
+		if (play) this->next_frame = now + this->remaining;
+		else this->remaining = std::max(std::chrono::steady_clock::duration::zero(), this->next_frame - now);
+	}
+	this->play = play;
 }
 
 /*
@@ -4,10 +4,16 @@ NICK WILSON
 2020
 */
 
-#include <thread>
+#include <vector>
+#include <deque>
+#include <thread>				//frame producer
+#include <mutex>				//ring lock
+#include <condition_variable>	//ring space
 
-#include "IVUtil.hpp"	//utilities
-#include "IVImage.hpp"	//base class
+#include "IVUtil.hpp"		//utilities
+#include "IVTrace.hpp"		//timing
+#include "IVImage.hpp"		//base class
+#include "IVGifStream.hpp"	//incremental decoding
 
 #include "gif_lib.h"	//gif support
 
@@ -15,14 +21,20 @@ NICK WILSON
 #define ANIMATEDIMAGE_H
 
 #define GIF_MIN_DELAY 0x02
+#define GIF_STREAM_THRESHOLD (16 << 20)	// files larger than this (in bytes) are decoded while playing instead of up front
+#define GIF_PRERENDER_BUDGET (256 << 20)	// memory (in bytes) frames made ahead of time may use, see prerender()
+#define GIF_RING_FRAMES 8					// frames composited ahead of the play head when they don't all fit the budget
+#define GIF_MAX_LAG 1000					// milliseconds playback may fall behind before it restarts from now rather than catching up
 
 class IVAnimatedImage : public IVImage{
 private:
-	GifFileType* gif_data = nullptr;
+	GifFileType* gif_data = nullptr;	// every frame, when the whole file was read up front
+	IVGifStream* stream = nullptr;		// a window of frames, when the file is read while playing
+	ColorMapObject* global_map = nullptr;
 	SDL_Surface* surface = nullptr;
 
 	uint8_t depth = 0;
-	uint16_t frame_index = 0;
+	uint32_t frame_index = 0;
 	uint16_t delay_val = 0;
 
 #ifdef MAKE_NO_PRERENDER
@@ -31,38 +43,83 @@ private:
 	bool prerendered = true;
 #endif
 
-	std::vector<SDL_Texture*> frames;
+	std::vector<SDL_Texture*> frames;	// every frame, when they all fit the budget
 
-	bool play = true;
-	bool quit = false;
+	// a frame composited ahead of time, as the region of the canvas it changed
+	struct rendered {
+		uint32_t index;
+		SDL_Rect dirty;
+		std::vector<uint8_t> pixels;
+	};
+
+	std::deque<rendered> ring;		// frames after the one shown, when they don't all fit. Filled by producer
+	size_t ring_capacity = 0;		// 0 when there's no producer
+	std::thread producer;
+	std::mutex ring_lock;
+	std::condition_variable ring_space;
+	bool stopping = false;
+	bool starved = false;			// prepare() couldn't reach the play head, the producer wakes the main loop when it can
 
-	std::thread animationThread;
+	uint32_t composited = 0;		// last frame drawn on to the canvas, or copied into the texture from the ring
+
+	bool play = true;
+	bool scheduled = false;
+	std::chrono::steady_clock::time_point next_frame;	// when frame_index stops being shown
+	std::chrono::steady_clock::duration remaining;		// time left on the current frame while paused
 
 	void setPalette(ColorMapObject* colorMap, SDL_Surface* surface);
 
-	void setIndex(uint16_t index);
+	void setIndex(uint32_t index);
 
-	uint16_t getDelay(uint16_t index);
+	uint16_t getDelay(uint32_t index);
 
 	uint16_t getDelay();
 
-	ExtensionBlock* getGraphicsBlock(uint16_t index);
+	SavedImage* getFrame(uint32_t index);
+
+	ExtensionBlock* getGraphicsBlock(SavedImage* frame);
+
+	bool composite(uint32_t index, SDL_Rect* dirty);
+
+	void produce(uint32_t index);
+
+	void update(const SDL_Rect* area, const uint8_t* pixels, int pitch);
+
+	uint32_t following(uint32_t index);
 
-	void animate();
+	void present(SDL_Rect* dirty);
 
 	void prerender();
 
 public:
-	uint16_t frame_count = 0;
+	uint32_t frame_count = 0;
 	bool playable;
 
 	IVAnimatedImage() {}
 
+	IVAnimatedImage(std::filesystem::path path);
+
 	IVAnimatedImage(SDL_Renderer* renderer, std::filesystem::path path);
 
 	~IVAnimatedImage();
 
-	void prepare(uint16_t index);
+	void decode();
+
+	void upload(SDL_Renderer* renderer);
+
+	void prepare(uint32_t index);
+
+	SDL_Surface* pixels(int w, int h);
+
+	void draw(SDL_Rect* destination, SDL_Rect* viewport);
+
+	size_t bytes();
+
+	bool advance(std::chrono::steady_clock::time_point now);
+
+	bool seek(std::chrono::steady_clock::time_point now);
+
+	std::chrono::steady_clock::time_point deadline();
 
 	void prepare();
 
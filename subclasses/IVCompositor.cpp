@@ -0,0 +1,320 @@
+/*
+IVCOMPOSITOR.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVCompositor.hpp"
+
+#include <cstring>		//strcmp
+#include <cmath>		//floor
+#include <algorithm>	//min, max, fill
+
+#ifdef __SSE2__
+#include <emmintrin.h>	//SSE2, always there on x86-64
+#endif
+
+/**
+* locate 		- Find the source pixels a sample position falls between
+* position 		> Position in source pixels, where 0.0 is the centre of the first one
+* size 			> Source extent
+* nearest 		> Snap to the closest pixel instead of weighing two
+* p0, p1 		< Pixels either side, clamped to the edge
+* weight 		< Share of p1, out of 256
+*/
+static void locate(double position, int size, bool nearest, int* p0, int* p1, uint16_t* weight) {
+	if (nearest) {
+		*p0 = *p1 = std::clamp((int) std::floor(position + 0.5), 0, size - 1);
+		*weight = 0;
+		return;
+	}
+
+	position = std::clamp(position, 0.0, (double) (size - 1));
+	int p = (int) position;
+	int share = (int) ((position - p) * 256 + 0.5);
+	if (share >= 256) {
+		p++;
+		share = 0;
+	}
+	*p0 = p;
+	*p1 = std::min(p + 1, size - 1);
+	*weight = (uint16_t) share;
+}
+
+#ifdef __SSE2__
+
+/**
+* bilinear 			- Blend four ARGB8888 pixels, a channel to each 16 bit lane. Each weighting is rounded to match the scalar code.
+* row0, row1 		> Source rows above and below the sample
+* x0, x1 			> Columns left and right of the sample
+* fx, fy 			> Share of the right column and lower row, out of 256
+* return - uint32_t	< Sampled pixel
+*/
+static inline uint32_t bilinear(const uint32_t* row0, const uint32_t* row1, int x0, int x1, uint16_t fx, uint16_t fy) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i half = _mm_set1_epi16(128);
+
+	// left pixel in the low four lanes, right pixel in the high four
+	__m128i top = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int) row0[x0]), _mm_cvtsi32_si128((int) row0[x1])), zero);
+	__m128i bottom = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int) row1[x0]), _mm_cvtsi32_si128((int) row1[x1])), zero);
+
+	__m128i wx = _mm_unpacklo_epi64(_mm_set1_epi16(256 - fx), _mm_set1_epi16(fx));
+	top = _mm_mullo_epi16(top, wx);
+	bottom = _mm_mullo_epi16(bottom, wx);
+	top = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(top, _mm_srli_si128(top, 8)), half), 8);
+	bottom = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(bottom, _mm_srli_si128(bottom, 8)), half), 8);
+
+	// then the same again down the column
+	__m128i wy = _mm_unpacklo_epi64(_mm_set1_epi16(256 - fy), _mm_set1_epi16(fy));
+	__m128i both = _mm_mullo_epi16(_mm_unpacklo_epi64(top, bottom), wy);
+	both = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(both, _mm_srli_si128(both, 8)), half), 8);
+
+	return (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(both, zero));
+}
+
+/**
+* over 				- Draw an ARGB8888 pixel over an opaque one, as SDL_BLENDMODE_BLEND would
+* pixel 			> Image pixel
+* background 		> Pixel underneath
+* return - uint32_t	< Blended pixel
+*/
+static inline uint32_t over(uint32_t pixel, uint32_t background) {
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i s = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) pixel), zero);
+	__m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) background), zero);
+	__m128i a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+
+	// divide by 255 exactly, with rounding
+	__m128i t = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(b, ia)), _mm_set1_epi16(128));
+	t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+
+	return (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(t, zero));
+}
+
+#else
+
+static inline uint32_t bilinear(const uint32_t* row0, const uint32_t* row1, int x0, int x1, uint16_t fx, uint16_t fy) {
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t top = (((row0[x0] >> shift) & 0xFF) * (256 - fx) + ((row0[x1] >> shift) & 0xFF) * fx + 128) >> 8;
+		uint32_t bottom = (((row1[x0] >> shift) & 0xFF) * (256 - fx) + ((row1[x1] >> shift) & 0xFF) * fx + 128) >> 8;
+		out |= ((top * (256 - fy) + bottom * fy + 128) >> 8) << shift;
+	}
+	return out;
+}
+
+static inline uint32_t over(uint32_t pixel, uint32_t background) {
+	uint32_t a = pixel >> 24;
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t t = ((pixel >> shift) & 0xFF) * a + ((background >> shift) & 0xFF) * (255 - a) + 128;
+		out |= ((t + (t >> 8)) >> 8) << shift;
+	}
+	return out;
+}
+
+#endif
+
+/* PRIVATE */
+
+/**
+* work - Worker thread body: help with each frame draw() hands out, until the compositor is destroyed
+*/
+void IVCompositor::work() {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> hold(this->lock);
+			this->wake.wait(hold, [&] { return this->stopping || this->generation != seen; });
+			if (this->stopping) return;
+			seen = this->generation;
+		}
+
+		run();
+
+		std::lock_guard<std::mutex> hold(this->lock);
+		if (--this->working == 0) this->finished.notify_one();
+	}
+}
+
+/**
+* run - Take bands of the current frame until there are none left
+*/
+void IVCompositor::run() {
+	int band;
+	while ((band = this->next_band.fetch_add(1)) < this->bands) {
+		int first = band * COMPOSITE_BAND_ROWS;
+		compose(first, std::min(this->target->h, first + COMPOSITE_BAND_ROWS));
+	}
+}
+
+/**
+* fill 		- Write the checkerboard into part of a row, the same pattern TiledTexture draws
+* row 		< Target row
+* y 		> Row index in the window
+* first 	> First column
+* last 		> One past the last column
+*/
+void IVCompositor::fill(uint32_t* row, int y, int first, int last) {
+	bool upper = (y % this->tile_h) < this->tile_h / 2;
+	int half = std::max(1, this->tile_w / 2);
+
+	// whole runs of one colour at a time
+	for (int x = first; x < last;) {
+		int phase = x % this->tile_w;
+		bool left = phase < half;
+		int end = std::min(last, x - phase + (left ? half : this->tile_w));
+		std::fill(row + x, row + end, (upper ^ left) ? this->high : this->low);
+		x = end;
+	}
+}
+
+/**
+* compose 	- Draw rows first to last of the frame: checkerboard wherever it shows, then the image sampled over it
+* first 	> First row
+* last 		> One past the last row
+*/
+void IVCompositor::compose(int first, int last) {
+	for (int y = first; y < last; y++) {
+		uint32_t* out = (uint32_t*) ((uint8_t*) this->target->pixels + (size_t) y * this->target->pitch);
+
+		if (y < this->visible.y || y >= this->visible.y + this->visible.h) {
+			fill(out, y, 0, this->target->w);
+			continue;
+		}
+
+		// an opaque image covers its part of the row completely
+		if (this->opaque) {
+			fill(out, y, 0, this->visible.x);
+			fill(out, y, this->visible.x + this->visible.w, this->target->w);
+		}
+		else {
+			fill(out, y, 0, this->target->w);
+		}
+
+		int y0, y1;
+		uint16_t fy;
+		locate((y - this->destination.y + 0.5) * this->source->h / this->destination.h - 0.5, this->source->h, this->nearest, &y0, &y1, &fy);
+		const uint32_t* row0 = (const uint32_t*) ((const uint8_t*) this->source->pixels + (size_t) y0 * this->source->pitch);
+		const uint32_t* row1 = (const uint32_t*) ((const uint8_t*) this->source->pixels + (size_t) y1 * this->source->pitch);
+
+		uint32_t* pixel = out + this->visible.x;
+		const column* c = this->columns.data();
+		int count = this->visible.w;
+
+		if (this->nearest && this->opaque) {
+			for (int i = 0; i < count; i++) pixel[i] = row0[c[i].x0];
+		}
+		else if (this->nearest) {
+			for (int i = 0; i < count; i++) pixel[i] = over(row0[c[i].x0], pixel[i]);
+		}
+		else if (this->opaque) {
+			for (int i = 0; i < count; i++) pixel[i] = bilinear(row0, row1, c[i].x0, c[i].x1, c[i].weight, fy);
+		}
+		else {
+			for (int i = 0; i < count; i++) pixel[i] = over(bilinear(row0, row1, c[i].x0, c[i].x1, c[i].weight, fy), pixel[i]);
+		}
+	}
+}
+
+/* PUBLIC */
+
+/**
+* usable 		- Whether the window is drawn by SDL's software renderer into a surface the compositor can write
+* win 			> Target Window object
+* return - bool	< True if draw() can be used instead of the renderer
+*/
+bool IVCompositor::usable(Window* win) {
+	SDL_RendererInfo info;
+	if (!win->renderer || SDL_GetRendererInfo(win->renderer, &info)) return false;
+	if (!(info.flags & SDL_RENDERER_SOFTWARE) && (!info.name || strcmp(info.name, "software"))) return false;
+
+	// pixels are written as ARGB8888, so the surface has to be that or RGB888, which only ignores the top byte
+	SDL_Surface* surface = SDL_GetWindowSurface(win->window);
+	return surface && surface->format->BytesPerPixel == 4 && surface->format->Rmask == 0x00FF0000
+		&& surface->format->Gmask == 0x0000FF00 && surface->format->Bmask == 0x000000FF;
+}
+
+/**
+* IVCompositor - Start a worker for every core but one, the thread calling draw() is the last
+*/
+IVCompositor::IVCompositor() {
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned i = 1; i < cores; i++) {
+		this->workers.emplace_back(&IVCompositor::work, this);
+	}
+}
+
+IVCompositor::~IVCompositor() {
+	{
+		std::lock_guard<std::mutex> hold(this->lock);
+		this->stopping = true;
+	}
+	this->wake.notify_all();
+	for (std::thread& worker : this->workers) worker.join();
+}
+
+/**
+* draw 			- Draw the checkerboard and image into the window surface, in bands of rows across every core.
+*				  Follows SDL_HINT_RENDER_SCALE_QUALITY like the renderer would. SDL_RenderPresent shows the result.
+* win 			> Target Window object
+* background 	> Checkerboard to draw behind the image
+* image 		> Image to draw, may be null or have no pixels yet, in which case only the checkerboard is drawn
+* destination 	> Where the whole image is placed in the window
+*/
+void IVCompositor::draw(Window* win, TiledTexture* background, IVImage* image, SDL_Rect* destination) {
+	IVTRACE_SCOPE("composite");
+	win->surface = SDL_GetWindowSurface(win->window);
+	this->target = win->surface;
+	if (!this->target) return;
+
+	this->high = background->HIGH;
+	this->low = background->LOW;
+	this->tile_w = std::max(1, background->w);
+	this->tile_h = std::max(1, background->h);
+
+	this->source = (image && destination->w > 0 && destination->h > 0) ? image->pixels(destination->w, destination->h) : nullptr;
+	if (this->source && this->source->format->format != SDL_PIXELFORMAT_ARGB8888) this->source = nullptr;
+
+	SDL_Rect window = {0, 0, this->target->w, this->target->h};
+	if (!this->source || !SDL_IntersectRect(destination, &window, &this->visible)) this->visible = {0, 0, 0, 0};
+
+	if (this->visible.w > 0) {
+		this->destination = *destination;
+		this->opaque = image->opaque;
+
+		// at exactly one pixel per pixel, nearest gives the same result for less work
+		const char* quality = SDL_GetHint(SDL_HINT_RENDER_SCALE_QUALITY);
+		this->nearest = !quality || !strcmp(quality, "0") || !strcmp(quality, "nearest")
+			|| (destination->w == this->source->w && destination->h == this->source->h);
+
+		// every row samples the same columns, so they're worked out once
+		this->columns.resize(this->visible.w);
+		for (int i = 0; i < this->visible.w; i++) {
+			column& c = this->columns[i];
+			double position = (this->visible.x + i - destination->x + 0.5) * this->source->w / destination->w - 0.5;
+			locate(position, this->source->w, this->nearest, &c.x0, &c.x1, &c.weight);
+		}
+	}
+
+	if (SDL_MUSTLOCK(this->target)) SDL_LockSurface(this->target);
+
+	this->bands = (this->target->h + COMPOSITE_BAND_ROWS - 1) / COMPOSITE_BAND_ROWS;
+	this->next_band = 0;
+	{
+		std::lock_guard<std::mutex> hold(this->lock);
+		this->generation++;
+		this->working = (int) this->workers.size();
+	}
+	this->wake.notify_all();
+
+	run();
+	{
+		std::unique_lock<std::mutex> hold(this->lock);
+		this->finished.wait(hold, [&] { return this->working == 0; });
+	}
+
+	if (SDL_MUSTLOCK(this->target)) SDL_UnlockSurface(this->target);
+}
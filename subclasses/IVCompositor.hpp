@@ -0,0 +1,76 @@
+/*
+IVCOMPOSITOR.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>				//standard number formats
+#include <vector>				//workers, column table
+#include <thread>				//row bands
+#include <mutex>				//frame hand off
+#include <condition_variable>	//frame hand off
+#include <atomic>				//next band
+
+#include "IVUtil.hpp"			//utilities
+#include "IVTrace.hpp"			//timing
+#include "Window.hpp"			//target
+#include "TiledTexture.hpp"		//checkerboard colours
+#include "IVImage.hpp"			//source pixels
+
+#ifndef IVCOMPOSITOR_H
+#define IVCOMPOSITOR_H
+
+#define COMPOSITE_BAND_ROWS 32	// rows handed out to a thread at a time
+
+/* Draws the checkerboard and image straight into the window surface on every core, for when the renderer is SDL's
+   software one and would otherwise scale on a single thread. Images keep their pixels in memory for it, see IVImage::keep_pixels */
+class IVCompositor {
+private:
+	// how one visible column samples the source: the two pixels either side and the weight of the right one, out of 256
+	struct column {
+		int x0, x1;
+		uint16_t weight;
+	};
+
+	// the frame being drawn, set up by draw() before the workers are woken
+	SDL_Surface* target = nullptr;
+	SDL_Surface* source = nullptr;
+	SDL_Rect destination;		// where the whole image lands
+	SDL_Rect visible;			// the part of destination inside the target
+	uint32_t high, low;
+	int tile_w, tile_h;
+	bool opaque = false;
+	bool nearest = false;
+	std::vector<column> columns;
+
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	uint64_t generation = 0;
+	int working = 0;			// workers yet to finish the current frame
+	int bands = 0;
+	std::atomic<int> next_band{0};
+	bool stopping = false;
+
+	void work();
+
+	void run();
+
+	void fill(uint32_t* row, int y, int first, int last);
+
+	void compose(int first, int last);
+
+public:
+	static bool usable(Window* win);
+
+	IVCompositor();
+
+	~IVCompositor();
+
+	void draw(Window* win, TiledTexture* background, IVImage* image, SDL_Rect* destination);
+};
+
+#endif
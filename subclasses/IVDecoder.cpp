@@ -0,0 +1,177 @@
+/*
+IVDECODER.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVDecoder.hpp"
+
+#include "IVStaticImage.hpp"
+#include "IVAnimatedImage.hpp"
+
+/* PRIVATE */
+
+/**
+* work - Worker thread body. Takes jobs from the front of the queue, decodes them and posts the result.
+*/
+void IVDecoder::work() {
+	while (true) {
+		job current;
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->wake.wait(guard, [this] { return this->quit || !this->queue.empty(); });
+			if (this->quit) return;
+
+			current = this->queue.front();
+			this->queue.pop_front();
+			this->active.push_back(current);
+		}
+
+		result done = {current.path, current.full, current.preview, nullptr, -1};
+		try {
+			done.image = create(current.path);
+			if (done.image && current.preview) {
+				IVTRACE_SCOPE("preview", current.path.string());
+				if (!done.image->decodePreview()) done.image = nullptr;
+			}
+			else if (done.image) {
+				done.image->reducible = !current.full;
+				done.image->progressive = !current.prefetch;
+				IVTRACE_SCOPE("decode", current.path.string());
+				done.image->decode();
+			}
+		}
+		catch (IVUTIL::IVEXCEPT except) {
+			done.image = nullptr;
+			done.error = except;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			for (auto it = this->active.begin(); it != this->active.end(); it++) {
+				if (it->path == current.path && it->full == current.full && it->preview == current.preview) {
+					this->active.erase(it);
+					break;
+				}
+			}
+			this->results.push_back(done);
+		}
+
+		// wake the main loop so it can upload the result
+		SDL_Event notify;
+		SDL_memset(&notify, 0, sizeof(notify));
+		notify.type = this->event_type;
+		SDL_PushEvent(&notify);
+	}
+}
+
+/* PUBLIC */
+
+/**
+* IVDecoder		- Start a pool of decode workers
+* threads		> Number of worker threads
+* event_type	> SDL event type pushed whenever a decode finishes
+*/
+IVDecoder::IVDecoder(unsigned threads, uint32_t event_type) {
+	this->event_type = event_type;
+	for (unsigned i = 0; i < std::max(1u, threads); i++) {
+		this->workers.emplace_back(&IVDecoder::work, this);
+	}
+}
+
+IVDecoder::~IVDecoder() {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->quit = true;
+		this->queue.clear();
+	}
+	this->wake.notify_all();
+	for (auto& worker : this->workers) worker.join();
+}
+
+/**
+* create 		- Construct the IVImage type matching a file, without decoding it
+* path 			> Path to the image
+* return - ptr 	< Undecoded image or nullptr if the format is unsupported
+*/
+std::shared_ptr<IVImage> IVDecoder::create(std::filesystem::path path) {
+	IVTRACE_SCOPE("detect");
+	const IVFORMAT::format* format = IVFORMAT::detect(path);
+	if (!format) return nullptr;
+
+	std::shared_ptr<IVImage> image;
+	if (format->capabilities & IVFORMAT::CAN_ANIMATE) image = std::make_shared<IVAnimatedImage>(path);
+	else image = std::make_shared<IVStaticImage>(path);
+	image->format = format;
+	return image;
+}
+
+/**
+* supersede - Drop everything still queued. Decodes already running can't be interrupted, their results still
+*			  arrive and are matched by path, so one no longer wanted only goes to the cache.
+*/
+void IVDecoder::supersede() {
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->queue.clear();
+}
+
+/**
+* request	- Queue a file for decoding. Images to be displayed go ahead of prefetches.
+* path		> Path to the image
+* prefetch	> true if the image is only wanted for the cache
+* full 		> true to decode every pixel, even if the window needs fewer
+*/
+void IVDecoder::request(std::filesystem::path path, bool prefetch, bool full) {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+
+		// already running, the result will turn up by itself. A full decode covers a reduced one but not the reverse
+		for (auto& running : this->active) {
+			if (running.path == path && !running.preview && (running.full || !full)) return;
+		}
+
+		for (auto it = this->queue.begin(); it != this->queue.end(); it++) {
+			if (it->path == path && it->full == full && !it->preview) {
+				if (prefetch || !it->prefetch) return;
+				// promote a queued prefetch to the front
+				this->queue.erase(it);
+				break;
+			}
+		}
+
+		if (prefetch) this->queue.push_back({path, prefetch, full, false});
+		else this->queue.push_front({path, prefetch, full, false});
+	}
+	this->wake.notify_one();
+}
+
+/**
+* preview	- Queue a read of the preview embedded in a file, ahead of everything else. Call after request() for the same file,
+*			  so that with more than one worker both start straight away.
+* path		> Path to the image
+*/
+void IVDecoder::preview(std::filesystem::path path) {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		// a preview for the same file is already in flight. a full decode running is no reason to skip, that's what the preview covers for
+		for (auto& running : this->active) {
+			if (running.path == path && running.preview) return;
+		}
+		for (auto& queued : this->queue) {
+			if (queued.path == path && queued.preview) return;
+		}
+		this->queue.push_front({path, false, false, true});
+	}
+	this->wake.notify_one();
+}
+
+/**
+* collect 			- Take every finished decode
+* return - vector 	< Results in order of completion
+*/
+std::vector<IVDecoder::result> IVDecoder::collect() {
+	std::lock_guard<std::mutex> guard(this->lock);
+	std::vector<result> done;
+	done.swap(this->results);
+	return done;
+}
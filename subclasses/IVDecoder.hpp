@@ -0,0 +1,73 @@
+/*
+IVDECODER.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>				//standard number formats
+#include <string>				//string type
+#include <filesystem>			//fs path
+#include <memory>				//shared_ptr
+#include <vector>				//worker and result lists
+#include <deque>				//job queue
+#include <thread>				//workers
+#include <mutex>				//queue lock
+#include <condition_variable>	//worker wakeup
+
+#include "IVUtil.hpp"			//utilities
+#include "IVTrace.hpp"			//timing
+#include "IVImage.hpp"			//decoded type
+
+#ifndef IVDECODER_H
+#define IVDECODER_H
+
+class IVDecoder {
+public:
+	struct result {
+		std::filesystem::path path;
+		bool full;						// decoded at full resolution to replace a reduced one
+		bool preview;					// only the embedded preview, to show until the real decode arrives
+		std::shared_ptr<IVImage> image;	// decoded but not uploaded, nullptr on failure
+		int error;						// IVUTIL::IVEXCEPT on failure, -1 if the format is unsupported
+	};
+
+private:
+	struct job {
+		std::filesystem::path path;
+		bool prefetch;
+		bool full;
+		bool preview;
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<job> queue;
+	std::vector<job> active;			// currently being decoded
+	std::vector<result> results;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	bool quit = false;
+
+	uint32_t event_type;
+
+	void work();
+
+public:
+	IVDecoder(unsigned threads, uint32_t event_type);
+
+	~IVDecoder();
+
+	static std::shared_ptr<IVImage> create(std::filesystem::path path);
+
+	void supersede();
+
+	void request(std::filesystem::path path, bool prefetch, bool full = false);
+
+	void preview(std::filesystem::path path);
+
+	std::vector<result> collect();
+};
+
+#endif
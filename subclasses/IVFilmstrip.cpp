@@ -0,0 +1,178 @@
+/*
+IVFILMSTRIP.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVFilmstrip.hpp"
+
+#include <unordered_set>	//visible set
+
+/* PRIVATE */
+
+/**
+* layout	- Work out how many neighbours fit either side of the current image
+* win 		> Target Window object
+* folder 	> Folder being browsed
+*/
+void IVFilmstrip::layout(Window* win, IVFolderIndex* folder) {
+	int cell = THUMB_SIZE + FILMSTRIP_GAP;
+	int fit = std::max(1, win->w / cell) / 2;
+	int others = (int) folder->size() - 1;
+
+	// every image appears once at most, even in a small folder where the ends would wrap around
+	this->behind = std::min(fit, std::max(0, others / 2));
+	this->ahead = std::min(fit, std::max(0, others - this->behind));
+}
+
+/**
+* release	- Destroy textures once there are too many, keeping the ones in view
+* visible 	> Images currently in view
+*/
+void IVFilmstrip::release(std::vector<std::filesystem::path>& visible) {
+	if (this->thumbnails.size() <= FILMSTRIP_TEXTURES) return;
+
+	std::unordered_set<std::string> keep;
+	for (auto& path : visible) keep.insert(path.string());
+
+	for (auto it = this->thumbnails.begin(); it != this->thumbnails.end();) {
+		if (keep.count(it->first)) {
+			it++;
+			continue;
+		}
+		SDL_DestroyTexture(it->second.texture);
+		it = this->thumbnails.erase(it);
+	}
+}
+
+/* PUBLIC */
+
+/**
+* IVFilmstrip	- Empty strip
+* renderer 		> Target SDL_Renderer
+* cache 		> Where thumbnails come from
+*/
+IVFilmstrip::IVFilmstrip(SDL_Renderer* renderer, IVThumbnailCache* cache) {
+	this->renderer = renderer;
+	this->cache = cache;
+}
+
+IVFilmstrip::~IVFilmstrip() {
+	for (auto& [path, s] : this->thumbnails) SDL_DestroyTexture(s.texture);
+}
+
+/**
+* height 		- Height of the strip
+* return - int	< Pixels taken up at the bottom of the window, 0 if hidden
+*/
+int IVFilmstrip::height() {
+	return this->shown ? THUMB_SIZE + FILMSTRIP_GAP * 2 : 0;
+}
+
+/**
+* draw 		- Draw the strip over the bottom of the window, asking for any thumbnails it doesn't have yet
+* win 		> Target Window object
+* folder 	> Folder being browsed
+*/
+void IVFilmstrip::draw(Window* win, IVFolderIndex* folder) {
+	if (!this->shown || !folder || !folder->size()) return;
+	layout(win, folder);
+
+	int cell = THUMB_SIZE + FILMSTRIP_GAP;
+	int top = win->h - height();
+
+	SDL_Rect band = {0, top, win->w, height()};
+	SDL_SetRenderDrawBlendMode(this->renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, 0xA0);
+	SDL_RenderFillRect(this->renderer, &band);
+
+	// nearest first, so they're asked for first
+	std::vector<std::filesystem::path> visible, missing;
+	for (int i = 0; i <= std::max(this->behind, this->ahead); i++) {
+		for (int steps : {i, -i}) {
+			if (steps > this->ahead || -steps > this->behind || (i == 0 && steps != i)) continue;
+			const std::filesystem::path& path = folder->at(steps);
+			visible.push_back(path);
+
+			int left = win->w / 2 - cell / 2 + steps * cell;
+			if (steps == 0) {
+				SDL_Rect frame = {left + FILMSTRIP_GAP / 4, top + FILMSTRIP_GAP / 4, cell - FILMSTRIP_GAP / 2, cell + FILMSTRIP_GAP / 2};
+				SDL_SetRenderDrawColor(this->renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+				SDL_RenderDrawRect(this->renderer, &frame);
+			}
+
+			auto found = this->thumbnails.find(path.string());
+			if (found == this->thumbnails.end()) {
+				missing.push_back(path);
+				continue;
+			}
+			slot& s = found->second;
+			if (!s.texture) continue;
+
+			// centred in its cell
+			SDL_Rect destination = {left + FILMSTRIP_GAP / 2 + (THUMB_SIZE - s.w) / 2, top + FILMSTRIP_GAP + (THUMB_SIZE - s.h) / 2, s.w, s.h};
+			SDL_RenderCopy(this->renderer, s.texture, nullptr, &destination);
+		}
+	}
+
+	if (!missing.empty() && missing != this->requested) {
+		this->cache->request(missing);
+		this->requested = missing;
+	}
+	release(visible);
+}
+
+/**
+* collect 		- Turn finished thumbnails into textures. Call from the main thread.
+* return - bool	< True if any arrived, so the strip should be redrawn
+*/
+bool IVFilmstrip::collect() {
+	std::vector<IVThumbnailCache::thumbnail> ready = this->cache->collect();
+	for (IVThumbnailCache::thumbnail& t : ready) {
+		slot& s = this->thumbnails[t.path.string()];
+		SDL_DestroyTexture(s.texture);
+		s = slot();
+		if (!t.w) continue;
+
+		s.texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, t.w, t.h);
+		if (!s.texture) continue;
+		SDL_UpdateTexture(s.texture, nullptr, t.pixels.data(), t.w * 4);
+		SDL_SetTextureBlendMode(s.texture, SDL_BLENDMODE_BLEND);
+		s.w = t.w;
+		s.h = t.h;
+	}
+	// anything still missing is asked for again on the next draw
+	if (!ready.empty()) this->requested.clear();
+	return !ready.empty();
+}
+
+/**
+* hit 			- Find the thumbnail under a point
+* win 			> Target Window object
+* x 			> Window x coordinate
+* y 			> Window y coordinate
+* steps 		< Signed number of images from the current one to the thumbnail
+* return - bool	< True if the point is on the strip, even if not on a thumbnail
+*/
+bool IVFilmstrip::hit(Window* win, int x, int y, int* steps) {
+	*steps = 0;
+	if (!this->shown || y < win->h - height()) return false;
+
+	int cell = THUMB_SIZE + FILMSTRIP_GAP;
+	int offset = x - (win->w / 2 - cell / 2);
+	int index = (offset < 0) ? (offset - cell + 1) / cell : offset / cell;
+	if (index >= -this->behind && index <= this->ahead) *steps = index;
+	return true;
+}
+
+/**
+* forget 	- Drop the thumbnail of an image that changed, so it's made again
+* path 		> Image path
+*/
+void IVFilmstrip::forget(std::filesystem::path path) {
+	auto found = this->thumbnails.find(path.string());
+	if (found == this->thumbnails.end()) return;
+	SDL_DestroyTexture(found->second.texture);
+	this->thumbnails.erase(found);
+	this->requested.clear();
+}
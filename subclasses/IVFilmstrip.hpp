@@ -0,0 +1,65 @@
+/*
+IVFILMSTRIP.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>			//standard number formats
+#include <string>			//string type
+#include <filesystem>		//fs path
+#include <vector>			//visible list
+#include <unordered_map>	//textures by path
+
+#include "IVUtil.hpp"			//utilities
+#include "IVThumbnailCache.hpp"	//thumbnails
+#include "IVFolderIndex.hpp"	//neighbours
+#include "Window.hpp"			//window size
+
+#ifndef IVFILMSTRIP_H
+#define IVFILMSTRIP_H
+
+#define FILMSTRIP_GAP 8				// space around each thumbnail
+#define FILMSTRIP_TEXTURES 512		// thumbnail textures kept before ones out of view are released
+
+/* Strip of thumbnails of the current image's neighbours along the bottom of the window */
+class IVFilmstrip {
+private:
+	// a slot without a texture is an image that couldn't be read, it isn't asked for again
+	struct slot {
+		SDL_Texture* texture = nullptr;
+		int w = 0, h = 0;
+	};
+
+	SDL_Renderer* renderer;
+	IVThumbnailCache* cache;
+	std::unordered_map<std::string, slot> thumbnails;
+	std::vector<std::filesystem::path> requested;	// last request made, so it isn't repeated every draw
+
+	int behind = 0;		// neighbours shown either side of the current image at the last draw
+	int ahead = 0;
+
+	void layout(Window* win, IVFolderIndex* folder);
+
+	void release(std::vector<std::filesystem::path>& visible);
+
+public:
+	bool shown = true;
+
+	IVFilmstrip(SDL_Renderer* renderer, IVThumbnailCache* cache);
+
+	~IVFilmstrip();
+
+	int height();
+
+	void draw(Window* win, IVFolderIndex* folder);
+
+	bool collect();
+
+	bool hit(Window* win, int x, int y, int* steps);
+
+	void forget(std::filesystem::path path);
+};
+
+#endif
@@ -0,0 +1,487 @@
+/*
+IVFOLDERINDEX.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVFolderIndex.hpp"
+
+#include <algorithm>	//sort, lower_bound
+#include <numeric>		//iota
+#include <cctype>		//tolower, isdigit
+
+/* PRIVATE */
+
+/**
+* adopt	- Browse in a new order, staying on the same image
+* ids 	> Every id (removed ones are skipped) in the new order
+*/
+void IVFolderIndex::adopt(std::vector<uint32_t>& ids) {
+	bool placed = !this->sequence.empty();
+	uint32_t id = placed ? this->sequence[this->current] : 0;
+
+	this->sequence.clear();
+	this->sequence.reserve(this->live);
+	for (uint32_t i : ids) {
+		if (!this->entries[i].removed) this->sequence.push_back(i);
+	}
+
+	this->position.resize(this->entries.size());
+	for (uint32_t p = 0; p < this->sequence.size(); p++) {
+		this->position[this->sequence[p]] = p;
+	}
+
+	this->current = (placed && !this->entries[id].removed) ? this->position[id] : 0;
+}
+
+/**
+* compact - Drop removed entries from the orderings once they make up half of them
+*/
+void IVFolderIndex::compact() {
+	if (this->live * 2 > this->sequence.size()) return;
+
+	auto removed = [this](uint32_t id) { return this->entries[id].removed; };
+	this->by_name.erase(std::remove_if(this->by_name.begin(), this->by_name.end(), removed), this->by_name.end());
+
+	std::vector<uint32_t> ids = this->sequence;
+	adopt(ids);
+}
+
+/**
+* insert 		- Add newly found images, skipping any already in the index
+* batch 		> Entries to add, emptied
+* return - bool	< True if anything was added
+*/
+bool IVFolderIndex::insert(std::vector<entry>& batch) {
+	uint32_t first = this->entries.size();
+	for (entry& e : batch) {
+		if (find(e.name) < 0) this->entries.push_back(std::move(e));
+	}
+	batch.clear();
+	uint32_t last = this->entries.size();
+	if (first == last) return false;
+	this->live += last - first;
+
+	// sort the newcomers by name and merge them into the lookup list
+	for (uint32_t id = first; id < last; id++) this->by_name.push_back(id);
+	auto middle = this->by_name.end() - (last - first);
+	auto byName = [this](uint32_t a, uint32_t b) {
+		return nameLess(this->entries[a].name, this->entries[b].name);
+	};
+	std::sort(middle, this->by_name.end(), byName);
+	std::inplace_merge(this->by_name.begin(), middle, this->by_name.end(), byName);
+
+	// other orders get the newcomers at the end, until they are next sorted
+	if (this->sort_order == ORDER_NAME) {
+		adopt(this->by_name);
+	}
+	else {
+		this->position.resize(last);
+		for (uint32_t id = first; id < last; id++) {
+			this->position[id] = this->sequence.size();
+			this->sequence.push_back(id);
+		}
+	}
+	return true;
+}
+
+/**
+* drop 			- Take an image out of the index, moving on to the next one if it was current
+* id 			> Entry to remove
+* return - bool	< True if it was the current image
+*/
+bool IVFolderIndex::drop(uint32_t id) {
+	bool current = (this->sequence[this->current] == id);
+	this->entries[id].removed = true;
+	this->live--;
+
+	if (current) this->current = step(this->current, 1);
+	compact();
+	return current;
+}
+
+/**
+* change 	- Apply a change reported by the folder watcher
+* c 		> Change to apply
+* changes 	> Added to with its effects
+*/
+void IVFolderIndex::change(IVFolderWatcher::change& c, update& changes) {
+	int64_t id = find(c.name);
+
+	if (c.type == IVFolderWatcher::CHANGE_REMOVED) {
+		if (id < 0) return;
+		changes.stale.push_back(this->entries[id].path);
+		changes.current |= drop(id);
+		changes.order = true;
+		return;
+	}
+
+	// rewritten in place
+	if (id >= 0) {
+		changes.stale.push_back(this->entries[id].path);
+		changes.current |= (this->sequence[this->current] == id);
+		return;
+	}
+
+	// new, or appeared before the background read got to it
+	if (!IVFORMAT::guess(std::filesystem::path(c.name).extension().string())) return;
+
+	std::error_code error;
+	std::filesystem::path path = this->folder / c.name;
+	if (!std::filesystem::is_regular_file(path, error)) return;
+	if (std::filesystem::is_symlink(path, error)) {
+		path = std::filesystem::canonical(path, error);
+		if (error) return;
+	}
+
+	std::vector<entry> batch = {{path, c.name, false}};
+	changes.order |= insert(batch);
+}
+
+/**
+* find 			- Look up an image by filename
+* name 			> Filename, matched exactly
+* return - int	< Id of the image, or -1 if there is no such image
+*/
+int64_t IVFolderIndex::find(const std::string& name) {
+	auto found = std::lower_bound(this->by_name.begin(), this->by_name.end(), name, [this](uint32_t id, const std::string& name) {
+		return nameLess(this->entries[id].name, name);
+	});
+	// a removed image may share its name with the one that replaced it
+	for (; found != this->by_name.end() && this->entries[*found].name == name; found++) {
+		if (!this->entries[*found].removed) return *found;
+	}
+	return -1;
+}
+
+/**
+* stopEnumerating - Abandon reading the folder, and any entries not yet collected
+*/
+void IVFolderIndex::stopEnumerating() {
+	if (this->enumerator.joinable()) {
+		this->cancel_enumerating = true;
+		this->enumerator.join();
+		this->cancel_enumerating = false;
+	}
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->found.clear();
+	this->found_all = false;
+}
+
+/**
+* stopSorting - Abandon a background sort in progress, and any finished one not yet collected
+*/
+void IVFolderIndex::stopSorting() {
+	if (this->sorter.joinable()) {
+		this->cancel = true;
+		this->sorter.join();
+		this->cancel = false;
+	}
+	std::lock_guard<std::mutex> guard(this->lock);
+	this->sorted.clear();
+	this->sorted_ready = false;
+}
+
+/**
+* step 			- Next place in sequence in a direction, skipping removed entries and wrapping around
+* place 		> Starting place
+* direction 	> +1 or -1
+*/
+uint32_t IVFolderIndex::step(uint32_t place, int direction) {
+	if (!this->live) return place;
+	size_t count = this->sequence.size();
+	do {
+		place = (place + count + direction) % count;
+	} while (this->entries[this->sequence[place]].removed);
+	return place;
+}
+
+/* PUBLIC */
+
+/**
+* IVFolderIndex	- Empty index, see load()
+* event_type	> SDL event type pushed when there is something to collect()
+*/
+IVFolderIndex::IVFolderIndex(uint32_t event_type) {
+	this->event_type = event_type;
+}
+
+IVFolderIndex::~IVFolderIndex() {
+	this->watcher.reset();
+	stopEnumerating();
+	stopSorting();
+}
+
+/**
+* load	- Start on a file, then read the rest of its folder in the background and watch it for changes.
+*		  The other images arrive through collect().
+* file 	> Canonical path of the open image
+*/
+void IVFolderIndex::load(std::filesystem::path file) {
+	this->watcher.reset();
+	stopEnumerating();
+	stopSorting();
+	this->entries.clear();
+	this->by_name.clear();
+	this->sequence.clear();
+	this->live = 0;
+	this->enumerated = false;
+
+	std::vector<entry> opened = {{file, file.filename().string(), false}};
+	insert(opened);
+
+	// watch first, so nothing changed while the folder is read gets missed
+	this->folder = file.parent_path();
+	this->watcher = std::make_unique<IVFolderWatcher>(this->folder, this->event_type);
+	if (!this->watcher->active) {
+		std::cerr << IVUTIL::LOG_WARNING << "Unable to watch folder for changes" << std::endl;
+	}
+
+	this->enumerator = std::thread([this]() {
+		std::vector<entry> batch;
+		size_t limit = FOLDER_BATCH_FIRST;
+
+		// hand a batch over and wake the main loop
+		auto deliver = [this, &batch](bool all) {
+			{
+				std::lock_guard<std::mutex> guard(this->lock);
+				for (entry& e : batch) this->found.push_back(std::move(e));
+				this->found_all = all;
+			}
+			batch.clear();
+
+			SDL_Event notify;
+			SDL_memset(&notify, 0, sizeof(notify));
+			notify.type = this->event_type;
+			SDL_PushEvent(&notify);
+		};
+
+		// the folder is resolved once, entries only need resolving themselves if they are links
+		std::error_code error;
+		std::filesystem::directory_iterator item(this->folder, error), end;
+		for (; !error && item != end; item.increment(error)) {
+			if (this->cancel_enumerating) return;
+
+			// Test that file is real file not link, folder, etc. and check it is a supported image format
+			std::error_code skip;
+			if (!item->is_regular_file(skip) || !IVFORMAT::guess(item->path().extension().string())) continue;
+
+			std::filesystem::path path = item->path();
+			if (item->is_symlink(skip)) {
+				path = std::filesystem::canonical(path, skip);
+				if (skip) continue;
+			}
+			batch.push_back({path, item->path().filename().string(), false});
+
+			if (batch.size() >= limit) {
+				deliver(false);
+				limit = std::min(limit * 2, (size_t) FOLDER_BATCH_MAX);
+			}
+		}
+
+		if (error) {
+			std::cerr << IVUTIL::LOG_WARNING << "Unable to read folder: " << error.message() << std::endl;
+		}
+		deliver(true);
+	});
+}
+
+/**
+* size - Number of images in the folder
+*/
+size_t IVFolderIndex::size() {
+	return this->live;
+}
+
+/**
+* get - Canonical path of the current image
+*/
+const std::filesystem::path& IVFolderIndex::get() {
+	if (!this->live) return this->none;
+	return this->entries[this->sequence[this->current]].path;
+}
+
+/**
+* at 		- Canonical path of the image a number of steps from the current one, wrapping around the folder
+* steps 	> Signed number of images to move
+*/
+const std::filesystem::path& IVFolderIndex::at(int steps) {
+	if (!this->live) return this->none;
+	uint32_t place = this->current;
+	for (int i = 0; i < std::abs(steps); i++) place = step(place, (steps < 0) ? -1 : 1);
+	return this->entries[this->sequence[place]].path;
+}
+
+/**
+* move 	- Make the image a number of steps away the current one
+* steps > Signed number of images to move
+*/
+void IVFolderIndex::move(int steps) {
+	for (int i = 0; i < std::abs(steps); i++) this->current = step(this->current, (steps < 0) ? -1 : 1);
+}
+
+/**
+* remove - Take the current image out of the index (after deleting it), moving on to the next one
+*/
+void IVFolderIndex::remove() {
+	if (!this->live) return;
+	drop(this->sequence[this->current]);
+}
+
+/**
+* sort 	- Browse in a different order. Anything that needs sorting is done in the background,
+*		  and the index keeps its current order until collect() picks up the result.
+* o 	> New order
+*/
+void IVFolderIndex::sort(order o) {
+	stopSorting();
+	this->sort_order = o;
+
+	// the lookup list is already in name order
+	if (o == ORDER_NAME) {
+		adopt(this->by_name);
+		return;
+	}
+
+	// the worker gets its own copy, so the index can keep being browsed and changed meanwhile
+	std::vector<uint32_t> ids = this->by_name;
+	this->sorted_count = this->entries.size();
+	std::vector<std::string> names;
+	std::vector<std::filesystem::path> paths;
+	for (entry& e : this->entries) {
+		if (o == ORDER_NATURAL) names.push_back(e.name);
+		else paths.push_back(e.path);
+	}
+
+	this->sorter = std::thread([this, o, ids, names, paths]() mutable {
+		if (o == ORDER_NATURAL) {
+			std::stable_sort(ids.begin(), ids.end(), [&names](uint32_t a, uint32_t b) {
+				return naturalLess(names[a], names[b]);
+			});
+		}
+		else {
+			// stat each file once, ties stay in name order. the file clock's epoch can be centuries off, so times are
+			// signed (and usually negative). a file that can't be read sorts first
+			std::vector<int64_t> keys(paths.size(), INT64_MIN);
+			for (uint32_t id : ids) {
+				if (this->cancel) return;
+				std::error_code error;
+				if (o == ORDER_MODIFIED) {
+					std::filesystem::file_time_type time = std::filesystem::last_write_time(paths[id], error);
+					if (!error) keys[id] = time.time_since_epoch().count();
+				}
+				else {
+					uintmax_t size = std::filesystem::file_size(paths[id], error);
+					if (!error) keys[id] = (int64_t) size;
+				}
+			}
+			std::stable_sort(ids.begin(), ids.end(), [&keys](uint32_t a, uint32_t b) {
+				return keys[a] < keys[b];
+			});
+		}
+		if (this->cancel) return;
+
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			this->sorted = std::move(ids);
+			this->sorted_ready = true;
+		}
+
+		// wake the main loop so it can switch over
+		SDL_Event notify;
+		SDL_memset(&notify, 0, sizeof(notify));
+		notify.type = this->event_type;
+		SDL_PushEvent(&notify);
+	});
+}
+
+/**
+* collect 			- Take in images read from the folder, changes seen by the watcher and the result
+*					  of a finished background sort. Call from the main thread.
+* return - update	< What changed
+*/
+IVFolderIndex::update IVFolderIndex::collect() {
+	update changes;
+
+	std::vector<entry> batch;
+	std::vector<uint32_t> ids;
+	bool all, resorted;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		batch.swap(this->found);
+		all = this->found_all;
+		this->found_all = false;
+		ids = std::move(this->sorted);
+		resorted = this->sorted_ready;
+		this->sorted_ready = false;
+	}
+
+	if (resorted) {
+		// anything that arrived while sorting goes on the end
+		for (uint32_t id = this->sorted_count; id < this->entries.size(); id++) ids.push_back(id);
+		adopt(ids);
+		changes.order = true;
+	}
+
+	changes.order |= insert(batch);
+
+	if (all) {
+		if (this->enumerator.joinable()) this->enumerator.join();
+		this->enumerated = true;
+		changes.enumerated = true;
+		// the order so far only covered part of the folder
+		if (this->sort_order != ORDER_NAME) sort(this->sort_order);
+	}
+
+	if (this->watcher) {
+		for (IVFolderWatcher::change& c : this->watcher->collect()) change(c, changes);
+	}
+
+	return changes;
+}
+
+/**
+* nameLess	- Case insensitive filename ordering, falling back on exact comparison so only identical names are equal
+*/
+bool IVFolderIndex::nameLess(const std::string& a, const std::string& b) {
+	size_t n = std::min(a.size(), b.size());
+	for (size_t i = 0; i < n; i++) {
+		int ca = std::tolower((unsigned char) a[i]);
+		int cb = std::tolower((unsigned char) b[i]);
+		if (ca != cb) return ca < cb;
+	}
+	if (a.size() != b.size()) return a.size() < b.size();
+	return a < b;
+}
+
+/**
+* naturalLess	- Filename ordering where runs of digits compare by value, so "IMG_9" comes before "IMG_10"
+*/
+bool IVFolderIndex::naturalLess(const std::string& a, const std::string& b) {
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size()) {
+		if (std::isdigit((unsigned char) a[i]) && std::isdigit((unsigned char) b[j])) {
+			// skip leading zeros, then a longer run of digits is a bigger number
+			while (i < a.size() && a[i] == '0') i++;
+			while (j < b.size() && b[j] == '0') j++;
+			size_t ei = i, ej = j;
+			while (ei < a.size() && std::isdigit((unsigned char) a[ei])) ei++;
+			while (ej < b.size() && std::isdigit((unsigned char) b[ej])) ej++;
+
+			if (ei - i != ej - j) return (ei - i) < (ej - j);
+			int c = a.compare(i, ei - i, b, j, ej - j);
+			if (c) return c < 0;
+			i = ei;
+			j = ej;
+		}
+		else {
+			int ca = std::tolower((unsigned char) a[i]);
+			int cb = std::tolower((unsigned char) b[j]);
+			if (ca != cb) return ca < cb;
+			i++;
+			j++;
+		}
+	}
+	if (a.size() - i != b.size() - j) return (a.size() - i) < (b.size() - j);
+	return nameLess(a, b);
+}
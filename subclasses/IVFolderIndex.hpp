@@ -0,0 +1,124 @@
+/*
+IVFOLDERINDEX.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>		//standard number formats
+#include <string>		//string type
+#include <filesystem>	//fs path
+#include <vector>		//entry lists
+#include <memory>		//unique_ptr
+#include <thread>		//background reading and sorting
+#include <mutex>		//result locks
+#include <atomic>		//cancellation
+
+#include "IVUtil.hpp"			//utilities
+#include "IVFormat.hpp"			//supported extensions
+#include "IVFolderWatcher.hpp"	//live changes
+
+#ifndef IVFOLDERINDEX_H
+#define IVFOLDERINDEX_H
+
+#define FOLDER_BATCH_FIRST 64	// the first entries are handed over early so neighbours can be prefetched at once
+#define FOLDER_BATCH_MAX 4096	// later batches double up to this size
+
+class IVFolderIndex {
+public:
+	enum order {
+		ORDER_NAME,		// case insensitive
+		ORDER_NATURAL,	// case insensitive, runs of digits compared as numbers
+		ORDER_MODIFIED,	// oldest first
+		ORDER_SIZE,		// smallest first
+		ORDER_COUNT,
+	};
+
+	struct update {
+		bool order = false;			// images were added, removed or reordered, so neighbours may differ
+		bool current = false;		// the current image was rewritten or removed
+		bool enumerated = false;	// the whole folder has now been read
+		std::vector<std::filesystem::path> stale;	// images whose decoded copies are out of date
+	};
+
+private:
+	struct entry {
+		std::filesystem::path path;	// canonical, resolved once when the folder is read
+		std::string name;			// filename, for sorting and lookup
+		bool removed;
+	};
+
+	std::vector<entry> entries;			// never reordered, so an entry's position is its id
+	std::vector<uint32_t> by_name;		// ids in ORDER_NAME, for lookup by filename
+	std::vector<uint32_t> sequence;		// ids in the order being browsed
+	std::vector<uint32_t> position;		// id -> place in sequence
+	uint32_t current = 0;				// place in sequence
+	size_t live = 0;					// entries not removed
+	std::filesystem::path none;			// returned when the folder is empty
+	std::filesystem::path folder;
+
+	std::thread enumerator;
+	std::atomic<bool> cancel_enumerating{false};
+	std::vector<entry> found;			// read in the background, waiting for collect()
+	bool found_all = false;
+
+	std::thread sorter;
+	std::atomic<bool> cancel{false};
+	std::mutex lock;
+	std::vector<uint32_t> sorted;		// finished background sort, waiting for collect()
+	bool sorted_ready = false;
+	uint32_t sorted_count = 0;			// entries that existed when the sort started
+
+	std::unique_ptr<IVFolderWatcher> watcher;
+
+	uint32_t event_type;
+
+	void adopt(std::vector<uint32_t>& ids);
+
+	bool insert(std::vector<entry>& batch);
+
+	bool drop(uint32_t id);
+
+	void change(IVFolderWatcher::change& c, update& changes);
+
+	int64_t find(const std::string& name);
+
+	void stopEnumerating();
+
+	void compact();
+
+	void stopSorting();
+
+	uint32_t step(uint32_t place, int direction);
+
+public:
+	order sort_order = ORDER_NAME;	// the order asked for, which may still be being worked out
+	bool enumerated = false;		// false while the folder is still being read
+
+	IVFolderIndex(uint32_t event_type);
+
+	~IVFolderIndex();
+
+	void load(std::filesystem::path file);
+
+	size_t size();
+
+	const std::filesystem::path& get();
+
+	const std::filesystem::path& at(int steps);
+
+	void move(int steps);
+
+	void remove();
+
+	void sort(order o);
+
+	update collect();
+
+	static bool nameLess(const std::string& a, const std::string& b);
+
+	static bool naturalLess(const std::string& a, const std::string& b);
+};
+
+#endif
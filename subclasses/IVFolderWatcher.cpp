@@ -0,0 +1,228 @@
+/*
+IVFOLDERWATCHER.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVFolderWatcher.hpp"
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#else
+	#include <sys/inotify.h>
+	#include <poll.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+#endif
+
+/* PRIVATE */
+
+/**
+* note		- Merge a change into those waiting to settle, so a file created then written is one addition
+* pending 	> Changes not yet delivered, by filename
+* type 		> What happened
+* name 		> Filename
+*/
+void IVFolderWatcher::note(std::map<std::string, change_type>& pending, change_type type, std::string name) {
+	auto found = pending.find(name);
+	if (found == pending.end()) {
+		pending[name] = type;
+		return;
+	}
+
+	change_type before = found->second;
+	if (before == CHANGE_ADDED && type == CHANGE_REMOVED) pending.erase(found);		// came and went
+	else if (before == CHANGE_ADDED) return;										// still new
+	else if (before == CHANGE_REMOVED && type == CHANGE_ADDED) found->second = CHANGE_MODIFIED;	// replaced
+	else found->second = type;
+}
+
+/**
+* deliver	- Hand settled changes to the main thread and wake it
+* pending 	> Changes to deliver, emptied
+*/
+void IVFolderWatcher::deliver(std::map<std::string, change_type>& pending) {
+	if (pending.empty()) return;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		for (auto& [name, type] : pending) this->changes.push_back({type, name});
+	}
+	pending.clear();
+
+	SDL_Event notify;
+	SDL_memset(&notify, 0, sizeof(notify));
+	notify.type = this->event_type;
+	SDL_PushEvent(&notify);
+}
+
+#ifdef _WIN32
+
+/**
+* watch - Wait on ReadDirectoryChangesW until stopped
+*/
+void IVFolderWatcher::watch() {
+	std::map<std::string, change_type> pending;
+	alignas(DWORD) BYTE buffer[32768];
+
+	OVERLAPPED overlapped;
+	SDL_memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	HANDLE handles[2] = {overlapped.hEvent, (HANDLE) this->stop};
+
+	while (!this->quit) {
+		ResetEvent(overlapped.hEvent);
+		if (!ReadDirectoryChangesW((HANDLE) this->directory, buffer, sizeof(buffer), FALSE,
+				FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+				nullptr, &overlapped, nullptr)) break;
+
+		// wait for more changes, delivering what's pending once things go quiet
+		DWORD waited;
+		while ((waited = WaitForMultipleObjects(2, handles, FALSE, pending.empty() ? INFINITE : WATCH_SETTLE_MS)) == WAIT_TIMEOUT) {
+			deliver(pending);
+		}
+
+		DWORD bytes = 0;
+		if (waited != WAIT_OBJECT_0 || !GetOverlappedResult((HANDLE) this->directory, &overlapped, &bytes, FALSE)) {
+			CancelIo((HANDLE) this->directory);
+			GetOverlappedResult((HANDLE) this->directory, &overlapped, &bytes, TRUE);
+			break;
+		}
+
+		// zero bytes means the buffer overflowed and the changes were lost
+		if (!bytes) {
+			std::cerr << IVUTIL::LOG_WARNING << "Too many folder changes at once, some were missed" << std::endl;
+			continue;
+		}
+
+		FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*) buffer;
+		while (true) {
+			std::string name = std::filesystem::path(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR))).string();
+			switch (info->Action) {
+				case FILE_ACTION_ADDED:
+				case FILE_ACTION_RENAMED_NEW_NAME:
+					note(pending, CHANGE_ADDED, name);
+					break;
+				case FILE_ACTION_REMOVED:
+				case FILE_ACTION_RENAMED_OLD_NAME:
+					note(pending, CHANGE_REMOVED, name);
+					break;
+				case FILE_ACTION_MODIFIED:
+					note(pending, CHANGE_MODIFIED, name);
+					break;
+			}
+			if (!info->NextEntryOffset) break;
+			info = (FILE_NOTIFY_INFORMATION*) ((BYTE*) info + info->NextEntryOffset);
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+/**
+* watch - Read inotify events until stopped
+*/
+void IVFolderWatcher::watch() {
+	std::map<std::string, change_type> pending;
+	alignas(struct inotify_event) char buffer[16384];
+
+	pollfd fds[2] = {{this->notify, POLLIN, 0}, {this->wake[0], POLLIN, 0}};
+
+	while (!this->quit) {
+		// wait for more changes, delivering what's pending once things go quiet
+		int ready = poll(fds, 2, pending.empty() ? -1 : WATCH_SETTLE_MS);
+		if (ready == 0) {
+			deliver(pending);
+			continue;
+		}
+		if (ready < 0 || (fds[1].revents & POLLIN)) break;
+
+		ssize_t length = read(this->notify, buffer, sizeof(buffer));
+		if (length <= 0) continue;
+
+		for (char* at = buffer; at < buffer + length; at += sizeof(struct inotify_event) + ((struct inotify_event*) at)->len) {
+			struct inotify_event* event = (struct inotify_event*) at;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				std::cerr << IVUTIL::LOG_WARNING << "Too many folder changes at once, some were missed" << std::endl;
+			}
+			if (!event->len || (event->mask & IN_ISDIR)) continue;
+
+			if (event->mask & (IN_CREATE | IN_MOVED_TO)) note(pending, CHANGE_ADDED, event->name);
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) note(pending, CHANGE_REMOVED, event->name);
+			else if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE)) note(pending, CHANGE_MODIFIED, event->name);
+		}
+	}
+}
+
+#endif
+
+/* PUBLIC */
+
+/**
+* IVFolderWatcher	- Start watching a folder
+* folder 			> Folder to watch
+* event_type 		> SDL event type pushed when changes are ready to collect
+*/
+IVFolderWatcher::IVFolderWatcher(std::filesystem::path folder, uint32_t event_type) {
+	this->folder = folder;
+	this->event_type = event_type;
+
+#ifdef _WIN32
+	HANDLE directory = CreateFileW(folder.wstring().c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directory == INVALID_HANDLE_VALUE) return;
+
+	this->directory = directory;
+	this->stop = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+#else
+	this->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (this->notify < 0) return;
+
+	uint32_t mask = IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_MODIFY | IN_CLOSE_WRITE;
+	if (inotify_add_watch(this->notify, folder.c_str(), mask) < 0 || pipe(this->wake) < 0) {
+		close(this->notify);
+		this->notify = -1;
+		return;
+	}
+#endif
+
+	this->active = true;
+	this->watcher = std::thread(&IVFolderWatcher::watch, this);
+}
+
+IVFolderWatcher::~IVFolderWatcher() {
+	this->quit = true;
+
+#ifdef _WIN32
+	if (this->stop) SetEvent((HANDLE) this->stop);
+	if (this->watcher.joinable()) this->watcher.join();
+	if (this->directory) CloseHandle((HANDLE) this->directory);
+	if (this->stop) CloseHandle((HANDLE) this->stop);
+#else
+	if (this->wake[1] >= 0) {
+		char stop = 1;
+		if (write(this->wake[1], &stop, 1) < 0) {} //the thread also checks quit, this just interrupts its wait
+	}
+	if (this->watcher.joinable()) this->watcher.join();
+	if (this->notify >= 0) close(this->notify);
+	if (this->wake[0] >= 0) close(this->wake[0]);
+	if (this->wake[1] >= 0) close(this->wake[1]);
+#endif
+}
+
+/**
+* collect 			- Take the changes delivered so far. Call from the main thread.
+* return - vector	< Settled changes in the order they were delivered
+*/
+std::vector<IVFolderWatcher::change> IVFolderWatcher::collect() {
+	std::lock_guard<std::mutex> guard(this->lock);
+	std::vector<change> taken;
+	taken.swap(this->changes);
+	return taken;
+}
@@ -0,0 +1,73 @@
+/*
+IVFOLDERWATCHER.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>		//standard number formats
+#include <string>		//string type
+#include <filesystem>	//fs path
+#include <vector>		//change list
+#include <map>			//settling changes
+#include <thread>		//watcher
+#include <mutex>		//change list lock
+#include <atomic>		//quit flag
+
+#include "IVUtil.hpp"	//utilities
+
+#ifndef IVFOLDERWATCHER_H
+#define IVFOLDERWATCHER_H
+
+#define WATCH_SETTLE_MS 250	// changes are held until a file has been quiet this long, so half written files aren't loaded
+
+/* Reports files added to, removed from or rewritten in a folder. Uses inotify on Linux and ReadDirectoryChangesW on Windows */
+class IVFolderWatcher {
+public:
+	enum change_type {
+		CHANGE_ADDED,
+		CHANGE_REMOVED,
+		CHANGE_MODIFIED,
+	};
+
+	struct change {
+		change_type type;
+		std::string name;	// filename within the folder
+	};
+
+private:
+	std::filesystem::path folder;
+	std::thread watcher;
+	std::atomic<bool> quit{false};
+
+	std::mutex lock;
+	std::vector<change> changes;
+
+	uint32_t event_type;
+
+#ifdef _WIN32
+	void* directory = nullptr;	// HANDLE
+	void* stop = nullptr;		// HANDLE, signalled to end the watch
+#else
+	int notify = -1;			// inotify descriptor
+	int wake[2] = {-1, -1};		// pipe written to end the watch
+#endif
+
+	void watch();
+
+	void note(std::map<std::string, change_type>& pending, change_type type, std::string name);
+
+	void deliver(std::map<std::string, change_type>& pending);
+
+public:
+	bool active = false;	// false if the platform couldn't watch the folder
+
+	IVFolderWatcher(std::filesystem::path folder, uint32_t event_type);
+
+	~IVFolderWatcher();
+
+	std::vector<change> collect();
+};
+
+#endif
@@ -0,0 +1,263 @@
+/*
+IVGIFSTREAM.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVGifStream.hpp"
+
+#include <cstring>		//memcpy
+
+/* IVGIFSOURCE */
+
+/**
+* input 		- giflib InputFunc, copies the next bytes out of the mapping
+* gif 			> File being read, UserData is the IVGifSource
+* buffer 		< Receives the bytes
+* length 		> Bytes wanted
+* return - int 	< Bytes copied, fewer at the end of the file
+*/
+int IVGifSource::input(GifFileType* gif, GifByteType* buffer, int length) {
+	IVGifSource* source = (IVGifSource*) gif->UserData;
+	size_t available = std::min((size_t) std::max(length, 0), source->file.size - source->position);
+	memcpy(buffer, source->file.data + source->position, available);
+	source->position += available;
+	return (int) available;
+}
+
+/**
+* map 			- Map a GIF for reading. giflib reads it front to back, so the OS is told to read ahead.
+* path 			> Path to the GIF
+* return - bool	< false if the file could not be opened
+*/
+bool IVGifSource::map(std::filesystem::path path) {
+	if (!this->file.open(path)) return false;
+	this->file.advise(IVMappedFile::ADVISE_SEQUENTIAL);
+	return true;
+}
+
+/**
+* open 			- Start giflib reading from the beginning of the mapping
+* return - ptr 	< Opened file positioned after the screen descriptor, nullptr if it isn't a GIF
+*/
+GifFileType* IVGifSource::open() {
+	this->position = 0;
+	return DGifOpen(this, &IVGifSource::input, nullptr);
+}
+
+/* PRIVATE */
+
+/**
+* open 			- (Re)open the file and read the screen descriptor, leaving it positioned before the first frame
+* return - bool	< false if the file could not be opened
+*/
+bool IVGifStream::open() {
+	if (this->gif) DGifCloseFile(this->gif, nullptr);
+	this->gif = this->source.open();
+	this->next = 0;
+	return this->gif != nullptr;
+}
+
+/**
+* read 			- Read records up to and including the next image, decoding its raster
+* return - ptr 	< Decoded frame, or nullptr at the end of the file or on a read error
+*/
+std::unique_ptr<IVGifStream::frame> IVGifStream::read() {
+	std::unique_ptr<frame> out(new frame());
+	GifRecordType type;
+
+	while (true) {
+		if (DGifGetRecordType(this->gif, &type) == GIF_ERROR) return nullptr;
+
+		switch (type) {
+			case EXTENSION_RECORD_TYPE: {
+				int code;
+				GifByteType* extension = nullptr;
+				if (DGifGetExtension(this->gif, &code, &extension) == GIF_ERROR) return nullptr;
+
+				// first byte is the sub-block length, see [1] in IVAnimatedImage.cpp for the payload
+				if (code == GRAPHICS_EXT_FUNC_CODE && extension && extension[0] >= 4) {
+					out->graphics.assign(extension + 1, extension + 1 + extension[0]);
+				}
+
+				// skip over any continuation sub-blocks
+				while (extension) {
+					if (DGifGetExtensionNext(this->gif, &extension) == GIF_ERROR) return nullptr;
+				}
+				break;
+			}
+			case IMAGE_DESC_RECORD_TYPE: {
+				if (DGifGetImageDesc(this->gif) == GIF_ERROR) return nullptr;
+
+				GifImageDesc* desc = &this->gif->Image;
+				out->raster.resize((size_t) desc->Width * desc->Height);
+
+				if (desc->Interlace) {
+					// interlaced rows arrive in four passes
+					const int offsets[] = {0, 4, 2, 1};
+					const int jumps[] = {8, 8, 4, 2};
+					for (int pass = 0; pass < 4; pass++) {
+						for (int y = offsets[pass]; y < desc->Height; y += jumps[pass]) {
+							if (DGifGetLine(this->gif, out->raster.data() + (size_t) y * desc->Width, desc->Width) == GIF_ERROR) return nullptr;
+						}
+					}
+				}
+				else {
+					for (int y = 0; y < desc->Height; y++) {
+						if (DGifGetLine(this->gif, out->raster.data() + (size_t) y * desc->Width, desc->Width) == GIF_ERROR) return nullptr;
+					}
+				}
+
+				out->saved.ImageDesc = *desc;
+				// giflib frees the local palette on the next descriptor, so keep a copy
+				out->saved.ImageDesc.ColorMap = desc->ColorMap ? GifMakeMapObject(desc->ColorMap->ColorCount, desc->ColorMap->Colors) : nullptr;
+				out->saved.RasterBits = out->raster.data();
+
+				if (out->graphics.empty()) {
+					out->saved.ExtensionBlockCount = 0;
+					out->saved.ExtensionBlocks = nullptr;
+				}
+				else {
+					out->block = {(int) out->graphics.size(), out->graphics.data(), GRAPHICS_EXT_FUNC_CODE};
+					out->saved.ExtensionBlockCount = 1;
+					out->saved.ExtensionBlocks = &out->block;
+				}
+
+				out->index = this->next++;
+				return out;
+			}
+			case TERMINATE_RECORD_TYPE:
+				return nullptr;
+			default:
+				break;
+		}
+	}
+}
+
+/**
+* run - Reader thread body. Keeps the window topped up with frames ahead of playback, looping back to the start of the file.
+*		Stops once a file turns out to hold a single frame.
+*/
+void IVGifStream::run() {
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->wake.wait(guard, [this] { return this->quit || this->window.size() < GIF_STREAM_WINDOW; });
+			if (this->quit) return;
+		}
+
+		// every frame has been read, start the next loop
+		if (this->frame_count && this->next >= this->frame_count && !open()) {
+			std::lock_guard<std::mutex> guard(this->lock);
+			this->failed = true;
+			this->wake.notify_all();
+			return;
+		}
+
+		std::unique_ptr<frame> decoded = read();
+
+		std::lock_guard<std::mutex> guard(this->lock);
+		if (!decoded) {
+			// first time at the end, or a damaged file that ends early - either way that's all the frames there are
+			if (!this->frame_count) this->frame_count = this->next;
+			else if (this->next < this->frame_count) this->failed = true;
+
+			if (!this->frame_count) this->failed = true;
+			this->wake.notify_all();
+			// a still image's one frame is never released from the window, so there's nothing left to read for good
+			if (this->failed || this->frame_count == 1) return;
+			continue;
+		}
+
+		// note the delay on the first pass so the animation can be timed without touching the frames
+		if (decoded->index >= this->delays.size()) {
+			uint16_t delay = 0;
+			if (decoded->graphics.size() >= 4) delay = ((uint16_t) decoded->graphics[2] << 8) + decoded->graphics[1];
+			this->delays.push_back(delay);
+		}
+
+		this->window.push_back(std::move(decoded));
+		this->wake.notify_all();
+	}
+}
+
+/* PUBLIC */
+
+/**
+* IVGifStream 	- Open a GIF for incremental decoding and start reading frames in the background
+* path 			> Path to the GIF. Throws IVUTIL::EXCEPT_IMG_OPEN_FAIL if it can't be opened.
+*/
+IVGifStream::IVGifStream(std::filesystem::path path) {
+	if (!this->source.map(path) || !open()) throw IVUTIL::EXCEPT_IMG_OPEN_FAIL;
+
+	this->w = this->gif->SWidth;
+	this->h = this->gif->SHeight;
+	this->background = this->gif->SBackGroundColor;
+	// reopening for each loop replaces the descriptor, so keep a copy
+	if (this->gif->SColorMap) this->colours = GifMakeMapObject(this->gif->SColorMap->ColorCount, this->gif->SColorMap->Colors);
+
+	this->reader = std::thread(&IVGifStream::run, this);
+}
+
+IVGifStream::~IVGifStream() {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->quit = true;
+	}
+	this->wake.notify_all();
+	this->reader.join();
+
+	// frames own palette copies
+	for (auto& decoded : this->window) GifFreeMapObject(decoded->saved.ImageDesc.ColorMap);
+	DGifCloseFile(this->gif, nullptr);
+	GifFreeMapObject(this->colours);
+}
+
+/**
+* acquire 		- Get a frame, waiting for it to be decoded if needed. Frames before it are released,
+*				  and the previously acquired frame must no longer be in use.
+* index 		> Frame index, wrapped to the frame count once it's known
+* return - ptr 	< The frame, or nullptr if the file can't be read any further
+*/
+SavedImage* IVGifStream::acquire(uint32_t index) {
+	std::unique_lock<std::mutex> guard(this->lock);
+	while (true) {
+		uint32_t count = this->frame_count;
+		uint32_t target = count ? index % count : index;
+
+		if (!this->window.empty()) {
+			if (this->window.front()->index == target) return &this->window.front()->saved;
+
+			// frames are read in order, so anything else at the front is finished with
+			GifFreeMapObject(this->window.front()->saved.ImageDesc.ColorMap);
+			this->window.pop_front();
+			this->wake.notify_all();
+			continue;
+		}
+
+		if (this->failed) return nullptr;
+		this->wake.wait(guard);
+	}
+}
+
+/**
+* multiple 		- Wait until it's known whether the file has more than one frame
+*/
+bool IVGifStream::multiple() {
+	std::unique_lock<std::mutex> guard(this->lock);
+	this->wake.wait(guard, [this] { return this->failed || this->frame_count || this->window.size() > 1; });
+	return this->window.size() > 1 || this->frame_count > 1;
+}
+
+/**
+* delay 		- Look up the delay of a frame read earlier, without waiting
+* index 		> Frame index
+* delay 		> Receives the delay in 1/100 s
+* return - bool	< false if the frame hasn't been read yet
+*/
+bool IVGifStream::delay(uint32_t index, uint16_t* delay) {
+	std::lock_guard<std::mutex> guard(this->lock);
+	if (index >= this->delays.size()) return false;
+	*delay = this->delays[index];
+	return true;
+}
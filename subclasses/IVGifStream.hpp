@@ -0,0 +1,90 @@
+/*
+IVGIFSTREAM.HPP
+NICK WILSON
+2020
+*/
+
+#include <cstdint>				//standard number formats
+#include <filesystem>			//fs path
+#include <memory>				//unique_ptr
+#include <vector>				//frame storage
+#include <deque>				//decoded window
+#include <thread>				//reader
+#include <mutex>				//window lock
+#include <condition_variable>	//reader/consumer wakeup
+#include <atomic>				//frame count
+
+#include "IVUtil.hpp"			//utilities
+#include "IVMappedFile.hpp"		//file input
+
+#include "gif_lib.h"			//gif support
+
+#ifndef IVGIFSTREAM_H
+#define IVGIFSTREAM_H
+
+#define GIF_STREAM_WINDOW 8		// frames decoded ahead of playback
+
+/* A mapped GIF that giflib reads through DGifOpen, so it never does file IO of its own */
+class IVGifSource {
+private:
+	IVMappedFile file;
+	size_t position = 0;
+
+	static int input(GifFileType* gif, GifByteType* buffer, int length);
+
+public:
+	bool map(std::filesystem::path path);
+
+	GifFileType* open();
+};
+
+class IVGifStream {
+private:
+	// one decoded frame, laid out as a giflib SavedImage so it can be used in place of DGifSlurp output
+	struct frame {
+		uint32_t index;
+		SavedImage saved;
+		std::vector<GifByteType> raster;
+		std::vector<GifByteType> graphics;	// graphics control extension payload, empty if none
+		ExtensionBlock block;
+	};
+
+	IVGifSource source;
+	GifFileType* gif = nullptr;
+	uint32_t next = 0;	// index of the next frame to be read from the file
+
+	std::deque<std::unique_ptr<frame>> window;
+	std::vector<uint16_t> delays;	// delay of every frame read so far, in 1/100 s
+	bool failed = false;
+	bool quit = false;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread reader;
+
+	bool open();
+
+	std::unique_ptr<frame> read();
+
+	void run();
+
+public:
+	int w = 0, h = 0;
+	int background = 0;
+	ColorMapObject* colours = nullptr;	// global palette, nullptr if the file has none
+
+	// 0 until the end of the file has been reached once
+	std::atomic<uint32_t> frame_count{0};
+
+	IVGifStream(std::filesystem::path path);
+
+	~IVGifStream();
+
+	SavedImage* acquire(uint32_t index);
+
+	bool multiple();
+
+	bool delay(uint32_t index, uint16_t* delay);
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*
+IVHEIFTILES.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVHeifTiles.hpp"
+
+/* PRIVATE */
+
+std::atomic<int> IVHeifTiles::running{0};
+
+/**
+* work - Tile thread body. Claims tiles in row order until there are none left, decoding each into its place in the canvas.
+*/
+void IVHeifTiles::work() {
+#if LIBHEIF_HAVE_VERSION(1, 18, 0)
+	// libheif makes no promise that one context can decode on several threads at once, so each thread reads the
+	// mapping into its own. That's only the box structure, no pixels, and every tile decode then touches nothing shared.
+	// libheif's own decoding threads are left off, these threads already cover the cores
+	heif::Context context;
+	heif::ImageHandle handle;
+	bool readable = true;
+	try {
+		context.set_max_decoding_threads(0);
+		context.read_from_memory_without_copy(this->input.data, this->input.size);
+		handle = context.get_primary_image_handle();
+	}
+	catch (...) {
+		readable = false;
+	}
+
+	for (uint32_t index = this->next++; index < this->columns * this->rows && !this->cancel; index = this->next++) {
+		uint32_t tx = index % this->columns;
+		uint32_t ty = index / this->columns;
+
+		heif_image* image = nullptr;
+		if (readable) {
+			IVTRACE_SCOPE("tile");
+			heif_error error = heif_image_handle_decode_image_tile(handle.get_raw_image_handle(), &image, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr, tx, ty);
+			if (error.code != heif_error_Ok) image = nullptr;
+		}
+		// a tile that won't decode is left transparent rather than losing the rest of the image
+		if (!image) std::cout << IVUTIL::LOG_WARNING << "LIBHEIF COULD NOT DECODE TILE " << tx << ", " << ty << std::endl;
+
+		// edge tiles are padded out to the full tile size, never read past one that came out smaller than the grid says
+		int x = tx * this->tile_w, y = ty * this->tile_h;
+		SDL_Rect area = {x, y, std::min((int) this->tile_w, this->w - x), std::min((int) this->tile_h, this->h - y)};
+		if (image) {
+			area.w = std::min(area.w, heif_image_get_width(image, heif_channel_interleaved));
+			area.h = std::min(area.h, heif_image_get_height(image, heif_channel_interleaved));
+		}
+
+		// convert here while there are cores to spare, rather than on the main thread
+		int pitch;
+		const uint8_t* plane = image ? heif_image_get_plane_readonly(image, heif_channel_interleaved, &pitch) : nullptr;
+		if (plane && area.w > 0 && area.h > 0) {
+			uint8_t* place = (uint8_t*) this->canvas->pixels + (size_t) y * this->canvas->pitch + (size_t) x * 4;
+			SDL_ConvertPixels(area.w, area.h, SDL_PIXELFORMAT_RGBA32, plane, pitch, this->format, place, this->canvas->pitch);
+		}
+		if (image) heif_image_release(image);
+
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			this->finished.push_back(area);
+		}
+		if (this->arrived) this->arrived();
+	}
+#endif
+	running--;
+}
+
+/* PUBLIC */
+
+IVHeifTiles::~IVHeifTiles() {
+	this->cancel = true;
+	for (auto& thread : this->threads) thread.join();
+	SDL_FreeSurface(this->canvas);
+}
+
+/**
+* open 			- Read the layout of a file libheif already has open, without decoding anything
+* handle 		> The file's primary image
+* return - bool < False if it isn't a grid or libheif is too old to decode tiles separately
+*/
+bool IVHeifTiles::open(heif::ImageHandle handle) {
+#if LIBHEIF_HAVE_VERSION(1, 18, 0)
+	// tiles come out rotated and mirrored as the file asks, the same as decoding the whole image would
+	heif_image_tiling tiling;
+	heif_error error = heif_image_handle_get_image_tiling(handle.get_raw_image_handle(), 1, &tiling);
+	if (error.code != heif_error_Ok) return false;
+	if (tiling.num_columns * tiling.num_rows < 2 || !tiling.tile_width || !tiling.tile_height) return false;
+
+	this->columns = tiling.num_columns;
+	this->rows = tiling.num_rows;
+	this->tile_w = tiling.tile_width;
+	this->tile_h = tiling.tile_height;
+	this->w = tiling.image_width;
+	this->h = tiling.image_height;
+	this->alpha = handle.has_alpha_channel();
+	return true;
+#else
+	(void) handle;
+	return false;
+#endif
+}
+
+/**
+* start 		- Begin decoding on as many threads as there are cores free, and at least one
+* file 			> Mapping the context reads from, taken over if this returns true so it outlives the caller
+* return - bool < False if there's no memory for the canvas, nothing is started
+*/
+bool IVHeifTiles::start(IVMappedFile& file) {
+	// starts out transparent, a tile that won't decode stays that way
+	this->canvas = SDL_CreateRGBSurfaceWithFormat(0, this->w, this->h, 32, this->format);
+	if (!this->canvas) return false;
+	this->input = std::move(file);
+
+	int cores = std::max(1u, std::thread::hardware_concurrency());
+	int count = std::max(1, std::min((int) (this->columns * this->rows), cores - running));
+	running += count;
+	for (int i = 0; i < count; i++) {
+		this->threads.emplace_back(&IVHeifTiles::work, this);
+	}
+	return true;
+}
+
+/**
+* ready - Whether any tiles are waiting for upload()
+*/
+bool IVHeifTiles::ready() {
+	std::lock_guard<std::mutex> guard(this->lock);
+	return !this->finished.empty();
+}
+
+/**
+* done - Whether every tile has been copied into the texture, so the decoder can be released
+*/
+bool IVHeifTiles::done() {
+	return this->uploaded == this->columns * this->rows;
+}
+
+/**
+* upload 	- Copy every tile decoded since the last call into its place in the texture
+* texture 	> Texture covering the whole image
+*/
+void IVHeifTiles::upload(SDL_Texture* texture) {
+	std::vector<SDL_Rect> arrived;
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		arrived.swap(this->finished);
+	}
+
+	IVTRACE_SCOPE("texture");
+	for (auto& area : arrived) {
+		if (area.w > 0 && area.h > 0) {
+			uint8_t* place = (uint8_t*) this->canvas->pixels + (size_t) area.y * this->canvas->pitch + (size_t) area.x * 4;
+			SDL_UpdateTexture(texture, &area, place, this->canvas->pitch);
+		}
+		this->uploaded++;
+	}
+}
+
+/**
+* take 					- Hand over the assembled image once done()
+* return - SDL_Surface*	< The canvas, now owned by the caller. nullptr before every tile is in, or if it was already taken
+*/
+SDL_Surface* IVHeifTiles::take() {
+	if (!done()) return nullptr;
+	SDL_Surface* canvas = this->canvas;
+	this->canvas = nullptr;
+	return canvas;
+}
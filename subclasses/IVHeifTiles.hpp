@@ -0,0 +1,75 @@
+/*
+IVHEIFTILES.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+#include <libheif/heif_cxx.h>
+
+#include <cstdint>		//standard number formats
+#include <vector>		//finished tiles
+#include <thread>		//tile decoders
+#include <mutex>		//finished list lock
+#include <atomic>		//tile counter
+
+#include "IVUtil.hpp"			//utilities
+#include "IVTrace.hpp"			//timing
+#include "IVMappedFile.hpp"		//file input
+
+#ifndef IVHEIFTILES_H
+#define IVHEIFTILES_H
+
+/* A grid HEIF (as phones save them) decoded one tile at a time across every core. Each tile is converted into its place
+   in a canvas on its thread, and the main thread copies it into the texture as it arrives, so the image fills in while
+   it decodes. The finished canvas is handed back for mips. Needs libheif 1.18 or newer, older versions never open anything. */
+class IVHeifTiles {
+private:
+	IVMappedFile input;			// each tile thread reads it into a context of its own, in place
+
+	uint32_t columns = 0, rows = 0;
+	uint32_t tile_w = 0, tile_h = 0;
+
+	// the whole image in format, each tile thread writes only its own tiles
+	SDL_Surface* canvas = nullptr;
+
+	std::vector<std::thread> threads;
+	std::atomic<uint32_t> next{0};		// next tile for a thread to claim
+	std::atomic<bool> cancel{false};
+
+	std::mutex lock;
+	std::vector<SDL_Rect> finished;		// in canvas, waiting for upload()
+	uint32_t uploaded = 0;				// tiles copied into the texture, main thread only
+
+	// tile threads of every image, so prefetches started while one decodes don't each claim every core
+	static std::atomic<int> running;
+
+	void work();
+
+public:
+	int w = 0, h = 0;
+	bool alpha = false;
+	uint32_t format = SDL_PIXELFORMAT_RGBA32;	// tiles are converted to this on their threads, set before start()
+	void (*arrived)() = nullptr;				// called on a tile thread as each tile finishes, set before start()
+
+	IVHeifTiles() {}
+
+	~IVHeifTiles();
+
+	bool open(heif::ImageHandle handle);
+
+	bool start(IVMappedFile& file);
+
+	bool ready();
+
+	bool done();
+
+	void upload(SDL_Texture* texture);
+
+	SDL_Surface* take();
+
+	IVHeifTiles(const IVHeifTiles&) = delete;
+	IVHeifTiles& operator=(const IVHeifTiles&) = delete;
+};
+
+#endif
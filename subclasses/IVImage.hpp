@@ -10,8 +10,11 @@ NICK WILSON
 #include <cstdint>		//standard number formats
 #include <string>		//string type
 #include <filesystem>	//fs path
+#include <chrono>		//animation clock
+#include <vector>		//texture formats
 
 #include "IVUtil.hpp"	//utilities
+#include "IVFormat.hpp"	//format registry
 
 #ifndef IVIMAGE_H
 #define IVIMAGE_H
@@ -20,20 +23,76 @@ class IVImage {
 protected:
 	SDL_Renderer* renderer = nullptr;
 
+	/* Wake the main loop so it calls advance() and finds what's ready. Safe from any thread */
+	static void notify() {
+		if (!event_ready) return;
+		SDL_Event ready;
+		SDL_memset(&ready, 0, sizeof(ready));
+		ready.type = event_ready;
+		SDL_PushEvent(&ready);
+	};
+
 public:
+	// 32 BPP format the renderer takes without converting, decoders produce it on their worker threads. See IVRENDER::nativeFormat
+	inline static uint32_t texture_format = SDL_PIXELFORMAT_ARGB8888;
+
+	// every 32 BPP format the renderer's textures hold as they are. Decoded surfaces already in one are uploaded unconverted. See IVRENDER::textureFormats
+	inline static std::vector<uint32_t> texture_formats;
+
+	// SDL event type pushed when an image's background work has something for prepare(), 0 until the main loop registers it
+	inline static uint32_t event_ready = 0;
+
+	// set when IVCompositor draws instead of the renderer: images hold their pixels in memory for it and make no textures
+	inline static bool keep_pixels = false;
+
 	enum state {
 		STATE_PLAY,
 		STATE_PAUSE,
 		STATE_TOGGLE,
 	};
 
-	uint16_t w, h;
+	std::filesystem::path path;
+	const IVFORMAT::format* format = nullptr;	// what the file turned out to be, once detected
+	int w, h;
+	int scale = 1;				// decoded at 1/scale of w and h because the window needs no more, see IVStaticImage::target_w
+	bool reducible = true;		// false to decode every pixel whatever the window size
+	bool progressive = false;	// decode() may return early and finish in the background, through advance() and prepare(). Only for an image about to be shown
 	bool animated = false;
-	bool ready = false;
+	bool preview = false;		// holds only the small preview embedded in the file, stretched to w and h
+	bool opaque = false;		// every pixel is fully opaque, so nothing behind the image needs drawing or blending
 	SDL_Texture* texture = nullptr;
 
+	/* Read and decode the file into CPU memory. Safe to call from a worker thread, throws IVUTIL::IVEXCEPT */
+	virtual void decode() {};
+
+	/* Decode just the preview embedded in the file instead, to show until decode() is done. false if there isn't one */
+	virtual bool decodePreview() { return false; };
+
+	/* Create textures from decoded data. Must be called from the thread that owns the renderer */
+	virtual void upload([[maybe_unused]] SDL_Renderer* renderer) {};
+
+	/* Move to the frame due at now. Returns true if prepare() should be called to show a new frame */
+	virtual bool advance([[maybe_unused]] std::chrono::steady_clock::time_point now) { return false; };
+
+	/* Like advance(), but after a spell of not being shown: jumps to the frame due at now however far behind it is */
+	virtual bool seek([[maybe_unused]] std::chrono::steady_clock::time_point now) { return false; };
+
+	/* When advance() next has something to do */
+	virtual std::chrono::steady_clock::time_point deadline() { return std::chrono::steady_clock::time_point::max(); };
+
 	virtual void prepare() {};
 
+	/* Draw the image scaled to fill destination. Anything outside viewport may be skipped */
+	virtual void draw(SDL_Rect* destination, [[maybe_unused]] SDL_Rect* viewport) {
+		SDL_RenderCopy(this->renderer, this->texture, nullptr, destination);
+	};
+
+	/* The pixels held for IVCompositor when keep_pixels is set, the copy nearest to w x h without being smaller. nullptr if there are none */
+	virtual SDL_Surface* pixels([[maybe_unused]] int w, [[maybe_unused]] int h) { return nullptr; };
+
+	/* Approximate memory held by the decoded image, used to budget caching */
+	virtual size_t bytes() { return (size_t) w * h * 4; };
+
 	/* [[maybe_unused]] attribute is new to C++17 */
 	virtual void set_status([[maybe_unused]] state s) {};
 
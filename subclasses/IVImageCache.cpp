@@ -0,0 +1,100 @@
+/*
+IVIMAGECACHE.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVImageCache.hpp"
+
+/* PRIVATE */
+
+/**
+* trim - Drop least recently used images until the cache fits inside its limit again
+*/
+void IVImageCache::trim() {
+	while (this->used > this->limit && !this->entries.empty()) {
+		this->used -= this->entries.back().bytes;
+		this->lookup.erase(this->entries.back().key);
+		this->entries.pop_back();
+	}
+}
+
+/* PUBLIC */
+
+IVImageCache::IVImageCache(size_t limit) {
+	this->limit = limit;
+}
+
+/**
+* get 			- Look up a decoded image and mark it as most recently used
+* path 			> Path the image was loaded from
+* return - ptr 	< Cached image or nullptr if not present
+*/
+std::shared_ptr<IVImage> IVImageCache::get(std::filesystem::path path) {
+	auto found = this->lookup.find(path.string());
+	if (found == this->lookup.end()) return nullptr;
+
+	// move to front without reallocating the entry
+	this->entries.splice(this->entries.begin(), this->entries, found->second);
+	return found->second->image;
+}
+
+/**
+* contains 		- Check for an image without changing its position
+* path 			> Path the image was loaded from
+*/
+bool IVImageCache::contains(std::filesystem::path path) {
+	return this->lookup.count(path.string()) > 0;
+}
+
+/**
+* size 			- Report the memory held by a cached image
+* path 			> Path the image was loaded from
+* return - size	< Size in bytes or 0 if not present
+*/
+size_t IVImageCache::size(std::filesystem::path path) {
+	auto found = this->lookup.find(path.string());
+	if (found == this->lookup.end()) return 0;
+	return found->second->bytes;
+}
+
+/**
+* put 		- Insert or replace an image as most recently used, evicting older images as required
+* path 		> Path the image was loaded from
+* image 	> Decoded image, ready to display
+*/
+void IVImageCache::put(std::filesystem::path path, std::shared_ptr<IVImage> image) {
+	evict(path);
+
+	size_t bytes = image->bytes();
+	// an image larger than the whole cache would only flush everything else out
+	if (bytes > this->limit) return;
+
+	this->entries.push_front({path.string(), image, bytes});
+	this->lookup[path.string()] = this->entries.begin();
+	this->used += bytes;
+
+	trim();
+}
+
+/**
+* evict - Remove an image from the cache, if present
+* path 	> Path the image was loaded from
+*/
+void IVImageCache::evict(std::filesystem::path path) {
+	auto found = this->lookup.find(path.string());
+	if (found == this->lookup.end()) return;
+
+	this->used -= found->second->bytes;
+	this->entries.erase(found->second);
+	this->lookup.erase(found);
+}
+
+/**
+* clear - Remove every image from the cache
+*/
+void IVImageCache::clear() {
+	this->entries.clear();
+	this->lookup.clear();
+	this->used = 0;
+}
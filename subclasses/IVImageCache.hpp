@@ -0,0 +1,54 @@
+/*
+IVIMAGECACHE.HPP
+NICK WILSON
+2020
+*/
+
+#include <cstdint>			//standard number formats
+#include <string>			//string type
+#include <filesystem>		//fs path
+#include <list>				//recency order
+#include <unordered_map>	//path lookup
+#include <memory>			//shared_ptr
+
+#include "IVImage.hpp"		//cached type
+
+#ifndef IVIMAGECACHE_H
+#define IVIMAGECACHE_H
+
+class IVImageCache {
+private:
+	struct entry {
+		std::string key;
+		std::shared_ptr<IVImage> image;
+		size_t bytes;
+	};
+
+	// front is most recently used, back is next to be evicted
+	std::list<entry> entries;
+	std::unordered_map<std::string, std::list<entry>::iterator> lookup;
+
+	void trim();
+
+public:
+	size_t limit = 0;
+	size_t used = 0;
+
+	IVImageCache() {}
+
+	IVImageCache(size_t limit);
+
+	std::shared_ptr<IVImage> get(std::filesystem::path path);
+
+	bool contains(std::filesystem::path path);
+
+	size_t size(std::filesystem::path path);
+
+	void put(std::filesystem::path path, std::shared_ptr<IVImage> image);
+
+	void evict(std::filesystem::path path);
+
+	void clear();
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*
+IVMAPPEDFILE.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVMappedFile.hpp"
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/file.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+/* PRIVATE */
+
+/**
+* map 			- Map the open file, which must already be at least size bytes for a read only mapping
+* size 			> Bytes to map
+* return - bool	< False if the mapping failed
+*/
+bool IVMappedFile::map(size_t size) {
+	// nothing to map, but an empty file is still a valid file
+	if (!size) return true;
+
+#ifdef _WIN32
+	this->mapping = CreateFileMappingW((HANDLE) this->file, nullptr, this->writable ? PAGE_READWRITE : PAGE_READONLY,
+		(DWORD) ((uint64_t) size >> 32), (DWORD) size, nullptr);
+	if (!this->mapping) return false;
+
+	this->data = (uint8_t*) MapViewOfFile((HANDLE) this->mapping, this->writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+	if (!this->data) {
+		CloseHandle((HANDLE) this->mapping);
+		this->mapping = nullptr;
+		return false;
+	}
+#else
+	void* data = mmap(nullptr, size, this->writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, this->file, 0);
+	if (data == MAP_FAILED) return false;
+	this->data = (uint8_t*) data;
+#endif
+
+	this->size = size;
+	return true;
+}
+
+/**
+* unmap - Release the mapping, leaving the file open
+*/
+void IVMappedFile::unmap() {
+#ifdef _WIN32
+	if (this->data) UnmapViewOfFile(this->data);
+	if (this->mapping) CloseHandle((HANDLE) this->mapping);
+	this->mapping = nullptr;
+#else
+	if (this->data) munmap(this->data, this->size);
+#endif
+	this->data = nullptr;
+	this->size = 0;
+}
+
+/* PUBLIC */
+
+IVMappedFile::~IVMappedFile() {
+	close();
+}
+
+/**
+* operator= 	- Take over another mapping, which is left closed
+* other 		> Mapping to take
+*/
+IVMappedFile& IVMappedFile::operator=(IVMappedFile&& other) {
+	if (this == &other) return *this;
+	close();
+	std::swap(this->file, other.file);
+#ifdef _WIN32
+	std::swap(this->mapping, other.mapping);
+#endif
+	std::swap(this->writable, other.writable);
+	std::swap(this->data, other.data);
+	std::swap(this->size, other.size);
+	return *this;
+}
+
+/**
+* open 			- Map a whole file for reading
+* path 			> File to map
+* return - bool	< False if the file couldn't be opened or mapped
+*/
+bool IVMappedFile::open(std::filesystem::path path) {
+	close();
+	this->writable = false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	this->file = file;
+
+	LARGE_INTEGER length;
+	if (!GetFileSizeEx(file, &length)) {
+		close();
+		return false;
+	}
+	size_t size = (size_t) length.QuadPart;
+#else
+	this->file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (this->file < 0) return false;
+
+	struct stat info;
+	if (fstat(this->file, &info) < 0) {
+		close();
+		return false;
+	}
+	size_t size = (size_t) info.st_size;
+#endif
+
+	if (!map(size)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+* create 		- Open a file for reading and writing, creating it or resizing it to the size provided and keeping what
+*				  fits of its contents. The file is locked against other processes, so only one can use it at a time.
+* path 			> File to map
+* size 			> Size in bytes
+* return - bool	< False if the file couldn't be opened, locked or mapped
+*/
+bool IVMappedFile::create(std::filesystem::path path, size_t size) {
+	close();
+	this->writable = true;
+
+#ifdef _WIN32
+	// no sharing at all, a second process fails to open it
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+		nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	this->file = file;
+#else
+	this->file = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (this->file < 0) return false;
+	if (flock(this->file, LOCK_EX | LOCK_NB) < 0) {
+		close();
+		return false;
+	}
+#endif
+
+	if (!resize(size)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+/**
+* resize 		- Change the size of a file opened with create(). The data pointer may move.
+* size 			> New size in bytes
+* return - bool	< False if the file couldn't be resized or remapped, in which case nothing is mapped
+*/
+bool IVMappedFile::resize(size_t size) {
+	if (!this->writable) return false;
+	unmap();
+
+#ifdef _WIN32
+	// growing happens when the mapping is created, shrinking needs the end of file moved
+	LARGE_INTEGER length;
+	length.QuadPart = (LONGLONG) size;
+	if (!SetFilePointerEx((HANDLE) this->file, length, nullptr, FILE_BEGIN) || !SetEndOfFile((HANDLE) this->file)) return false;
+#else
+	if (ftruncate(this->file, (off_t) size) < 0) return false;
+#endif
+
+	return map(size);
+}
+
+/**
+* advise 	- Tell the OS how the mapping is about to be read, so it can read ahead or hold off accordingly.
+*			  Windows has no equivalent for mapped views, there it does nothing.
+* a 		> Expected access pattern
+*/
+void IVMappedFile::advise([[maybe_unused]] advice a) {
+#ifndef _WIN32
+	if (!this->data) return;
+	int hints[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED};
+	madvise(this->data, this->size, hints[a]);
+#endif
+}
+
+/**
+* close - Unmap and close the file. Writes reach the file through the page cache without any further step.
+*/
+void IVMappedFile::close() {
+	unmap();
+#ifdef _WIN32
+	if (this->file) CloseHandle((HANDLE) this->file);
+	this->file = nullptr;
+#else
+	if (this->file >= 0) ::close(this->file);
+	this->file = -1;
+#endif
+}
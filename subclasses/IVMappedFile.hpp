@@ -0,0 +1,64 @@
+/*
+IVMAPPEDFILE.HPP
+NICK WILSON
+2020
+*/
+
+#include <cstdint>		//standard number formats
+#include <cstddef>		//size_t
+#include <filesystem>	//fs path
+#include <utility>		//swap, move
+
+#ifndef IVMAPPEDFILE_H
+#define IVMAPPEDFILE_H
+
+/* A file mapped into memory, so its bytes come straight from the OS page cache. Uses mmap, or file mappings on Windows */
+class IVMappedFile {
+private:
+#ifdef _WIN32
+	void* file = nullptr;		// HANDLE
+	void* mapping = nullptr;	// HANDLE
+#else
+	int file = -1;
+#endif
+	bool writable = false;
+
+	bool map(size_t size);
+
+	void unmap();
+
+public:
+	enum advice {
+		ADVISE_NORMAL,
+		ADVISE_SEQUENTIAL,	// read once from start to end
+		ADVISE_RANDOM,		// read in scattered places
+		ADVISE_WILLNEED,	// about to be read, start paging it in
+	};
+
+	uint8_t* data = nullptr;
+	size_t size = 0;
+
+	IVMappedFile() {}
+
+	IVMappedFile(const IVMappedFile&) = delete;
+
+	IVMappedFile& operator=(const IVMappedFile&) = delete;
+
+	IVMappedFile(IVMappedFile&& other) { *this = std::move(other); }
+
+	IVMappedFile& operator=(IVMappedFile&& other);
+
+	~IVMappedFile();
+
+	bool open(std::filesystem::path path);
+
+	bool create(std::filesystem::path path, size_t size);
+
+	bool resize(size_t size);
+
+	void advise(advice a);
+
+	void close();
+};
+
+#endif
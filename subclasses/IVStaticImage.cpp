@@ -5,28 +5,353 @@ NICK WILSON
 */
 
 #include "IVStaticImage.hpp"
+#include "IVRender.hpp"
+
+#include <csetjmp>		//libjpeg error recovery
+#include <cstring>		//memcmp
+#include <cmath>		//std::abs
+
+/* libjpeg reports errors by calling error_exit, which must not return */
+struct jpegError {
+	jpeg_error_mgr manager;
+	jmp_buf jump;
+};
+
+static void jpegExit(j_common_ptr info) {
+	longjmp(((jpegError*) info->err)->jump, 1);
+}
+
+/* warnings about slightly damaged files aren't worth printing */
+static void jpegMessage([[maybe_unused]] j_common_ptr info) {}
+
+/* libjpeg's extended colour spaces name bytes in memory order, like SDL's RGBA32 family. Anything else is decoded as RGBA32 */
+static J_COLOR_SPACE jpegSpace(uint32_t* format) {
+	if (*format == SDL_PIXELFORMAT_BGRA32) return JCS_EXT_BGRA;
+	if (*format == SDL_PIXELFORMAT_ARGB32) return JCS_EXT_ARGB;
+	if (*format == SDL_PIXELFORMAT_ABGR32) return JCS_EXT_ABGR;
+	*format = SDL_PIXELFORMAT_RGBA32;
+	return JCS_EXT_RGBA;
+}
+
+/* PRIVATE */
+
+/**
+* decodeJPEG			- Decode a JPEG with libjpeg, using its DCT scaling to produce only the pixels the window needs.
+*						  Sets w and h to the full size and scale to the reduction used.
+* data 				> The whole JPEG
+* size 				> Its length in bytes
+* return - SDL_Surface*	< Decoded pixels, nullptr if libjpeg couldn't manage and SDL_image should try instead
+*/
+SDL_Surface* IVStaticImage::decodeJPEG(const uint8_t* data, size_t size) {
+	IVTRACE_SCOPE("read");
+	jpeg_decompress_struct info;
+	jpegError error;
+	SDL_Surface* volatile surface = nullptr;
+
+	info.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = jpegExit;
+	error.manager.output_message = jpegMessage;
+	if (setjmp(error.jump)) {
+		this->scale = 1;
+		jpeg_destroy_decompress(&info);
+		SDL_FreeSurface(surface);
+		return nullptr;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_mem_src(&info, data, size);
+	jpeg_read_header(&info, TRUE);
+
+	// libjpeg can't produce RGB from CMYK
+	if (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK) longjmp(error.jump, 1);
+
+	this->w = info.image_width;
+	this->h = info.image_height;
+	this->scale = this->reducible ? reduction(this->w, this->h) : 1;
+
+	// straight into the renderer's format where libjpeg can manage it
+	uint32_t format = texture_format;
+	info.scale_num = 1;
+	info.scale_denom = this->scale;
+	info.out_color_space = jpegSpace(&format);
+	jpeg_start_decompress(&info);
+
+	surface = SDL_CreateRGBSurfaceWithFormat(0, info.output_width, info.output_height, 32, format);
+	if (!surface) longjmp(error.jump, 1);
+
+	while (info.output_scanline < info.output_height) {
+		JSAMPROW row = (uint8_t*) surface->pixels + (size_t) info.output_scanline * surface->pitch;
+		jpeg_read_scanlines(&info, &row, 1);
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+	return surface;
+}
+
+/**
+* findExifThumbnail	- Walk a JPEG's segments for the thumbnail cameras store in the EXIF block, and the size of the main image
+* data 				> The whole JPEG
+* size 				> Its length in bytes
+* thumbnail 		< Start of the embedded thumbnail, itself a complete JPEG
+* length 			< Length of the thumbnail in bytes
+* w, h 				< Size of the main image
+* return - bool 	< True if both were found
+*/
+bool IVStaticImage::findExifThumbnail(const uint8_t* data, size_t size, const uint8_t** thumbnail, size_t* length, int* w, int* h) {
+	*thumbnail = nullptr;
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+	size_t at = 2;
+	while (at + 4 <= size && data[at] == 0xFF) {
+		uint8_t marker = data[at + 1];
+		size_t segment = ((size_t) data[at + 2] << 8) | data[at + 3];
+		if (segment < 2 || at + 2 + segment > size) return false;
+		const uint8_t* body = data + at + 4;
+		size_t body_size = segment - 2;
+
+		// APP1 holding EXIF: a TIFF structure whose second IFD describes the thumbnail
+		if (marker == 0xE1 && body_size > 14 && !memcmp(body, "Exif\0\0", 6)) {
+			const uint8_t* tiff = body + 6;
+			size_t tiff_size = body_size - 6;
+			bool motorola = tiff[0] == 'M';
+			auto u16 = [&](size_t offset) -> uint32_t {
+				if (offset + 2 > tiff_size) return 0;
+				return motorola ? (tiff[offset] << 8) | tiff[offset + 1] : tiff[offset] | (tiff[offset + 1] << 8);
+			};
+			auto u32 = [&](size_t offset) -> uint32_t {
+				if (offset + 4 > tiff_size) return 0;
+				return motorola ? (u16(offset) << 16) | u16(offset + 2) : u16(offset) | (u16(offset + 2) << 16);
+			};
+
+			size_t ifd0 = u32(4);
+			size_t ifd1 = u32(ifd0 + 2 + 12 * (size_t) u16(ifd0));
+			if (ifd0 && ifd1 && ifd1 < tiff_size) {
+				size_t offset = 0, bytes = 0;
+				for (uint32_t i = 0, count = u16(ifd1); i < count; i++) {
+					size_t entry = ifd1 + 2 + 12 * (size_t) i;
+					if (u16(entry) == 0x0201) offset = u32(entry + 8);	// JPEGInterchangeFormat
+					if (u16(entry) == 0x0202) bytes = u32(entry + 8);	// JPEGInterchangeFormatLength
+				}
+				if (offset && bytes && offset + bytes <= tiff_size) {
+					*thumbnail = tiff + offset;
+					*length = bytes;
+				}
+			}
+		}
+		// start of frame, every kind except DHT, JPG and DAC which share the range
+		else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (body_size < 5) return false;
+			*h = (body[1] << 8) | body[2];
+			*w = (body[3] << 8) | body[4];
+			return *thumbnail != nullptr && *w > 0 && *h > 0;
+		}
+		// image data follows, no frame header was seen
+		else if (marker == 0xDA) {
+			return false;
+		}
+		at += 2 + segment;
+	}
+	return false;
+}
+
+/**
+* cropToAspect			- Cut the black bars off a preview made at a different shape to the image it stands in for,
+*						  as cameras often store a 4:3 thumbnail of a 3:2 photo. Takes ownership of surface.
+* surface 				> Decoded preview
+* w, h 					> Size of the main image
+* return - SDL_Surface*	< The preview, cropped if needed
+*/
+SDL_Surface* IVStaticImage::cropToAspect(SDL_Surface* surface, int w, int h) {
+	float image = w / (float) h;
+	float preview = surface->w / (float) surface->h;
+	if (std::abs(image - preview) < image * 0.02f) return surface;
+
+	SDL_Rect area = {0, 0, surface->w, surface->h};
+	if (preview > image) area.w = std::max(1, (int) (surface->h * image + 0.5f));
+	else area.h = std::max(1, (int) (surface->w / image + 0.5f));
+	area.x = (surface->w - area.w) / 2;
+	area.y = (surface->h - area.h) / 2;
+
+	SDL_Surface* cropped = SDL_CreateRGBSurfaceWithFormat(0, area.w, area.h, 32, surface->format->format);
+	if (!cropped) return surface;
+	SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+	SDL_BlitSurface(surface, &area, cropped, nullptr);
+	SDL_FreeSurface(surface);
+	return cropped;
+}
+
+/**
+* buildMips - Halve the decoded surface until it fits MIP_MIN, so a zoomed out image is drawn from a copy
+*			  close to its size on screen rather than having the GPU sample every pixel of the original
+*/
+void IVStaticImage::buildMips() {
+	if (std::max(this->surface->w, this->surface->h) <= MIP_MIN) return;
+	IVTRACE_SCOPE("mips");
+
+	// the kernels work on 32 BPP, anything else is converted once here (keeping any colour key as alpha)
+	if (this->surface->format->BytesPerPixel != 4) {
+		SDL_Surface* converted = SDL_ConvertSurfaceFormat(this->surface, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (!converted) return;
+		SDL_FreeSurface(this->surface);
+		this->surface = converted;
+	}
+
+	SDL_Surface* level = this->surface;
+	while (std::max(level->w, level->h) > MIP_MIN) {
+		level = IVSCALE::halve(level);
+		if (!level) break;
+		this->mips.push_back({level, nullptr, level->w, level->h});
+	}
+}
+
+/**
+* uploadMips 	- Create a texture for every mip level alongside the full size one, and release their surfaces
+* blend 		> Blend mode of the full size texture
+*/
+void IVStaticImage::uploadMips(SDL_BlendMode blend) {
+	for (auto& level : this->mips) {
+		if (this->texture) {
+			IVTRACE_SCOPE("texture");
+			level.texture = IVRENDER::createTexture(this->renderer, level.surface, SDL_TEXTUREACCESS_STREAMING);
+			if (level.texture) SDL_SetTextureBlendMode(level.texture, blend);
+		}
+		SDL_FreeSurface(level.surface);
+		level.surface = nullptr;
+	}
+}
+
+/**
+* reduction 	- Largest DCT scaling (1/2, 1/4 or 1/8) that still leaves enough pixels to fit the target area
+* w 			> Full image width
+* h 			> Full image height
+* return - int 	< Denominator of the scaling, 1 for none
+*/
+int IVStaticImage::reduction(int w, int h) {
+	int target_w = IVStaticImage::target_w;
+	int target_h = IVStaticImage::target_h;
+	if (target_w <= 0 || target_h <= 0 || w <= 0 || h <= 0) return 1;
+
+	// images are only ever shrunk to fit, never stretched
+	float fit = std::min(1.0f, std::min(target_w / (float) w, target_h / (float) h));
+	int denominator = 8;
+	while (denominator > 1 && denominator * fit > 1.0f) denominator /= 2;
+	return denominator;
+}
+
+/**
+* covers 		- Whether every pixel of a surface is fully opaque. Stops at the first one that isn't.
+* surface 		> Decoded surface
+* return - bool < True if the surface completely hides anything drawn behind it
+*/
+bool IVStaticImage::covers(SDL_Surface* surface) {
+	if (SDL_HasColorKey(surface)) return false;
+
+	SDL_PixelFormat* format = surface->format;
+	if (format->palette) {
+		for (int i = 0; i < format->palette->ncolors; i++) {
+			if (format->palette->colors[i].a != 255) return false;
+		}
+		return true;
+	}
+	if (!format->Amask) return true;
+	// an alpha channel is no proof of transparency, plenty of PNGs are saved with one regardless
+	if (format->BytesPerPixel != 4) return false;
+
+	if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+	bool opaque = true;
+	for (int y = 0; y < surface->h && opaque; y++) {
+		uint32_t* row = (uint32_t*) ((uint8_t*) surface->pixels + (size_t) y * surface->pitch);
+		for (int x = 0; x < surface->w; x++) {
+			if ((row[x] & format->Amask) != format->Amask) {
+				opaque = false;
+				break;
+			}
+		}
+	}
+	if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+	return opaque;
+}
 
 /* PUBLIC */
 
-IVStaticImage::IVStaticImage(SDL_Renderer* renderer, std::filesystem::path path) {
+int IVStaticImage::texture_max_w = TILE_THRESHOLD;
+int IVStaticImage::texture_max_h = TILE_THRESHOLD;
+std::atomic<int> IVStaticImage::target_w{0};
+std::atomic<int> IVStaticImage::target_h{0};
+
+IVStaticImage::IVStaticImage(std::filesystem::path path) {
+	this->path = path;
+	this->animated = false;
+}
+
+IVStaticImage::IVStaticImage(SDL_Renderer* renderer, std::filesystem::path path) : IVStaticImage(path) {
+	decode();
+	upload(renderer);
+}
+
+IVStaticImage::~IVStaticImage() {
+	delete this->tiles;
+	delete this->pyramid;
+	for (auto& level : this->mips) {
+		SDL_FreeSurface(level.surface);
+		SDL_DestroyTexture(level.texture);
+	}
+	SDL_FreeSurface(this->surface);
+	SDL_DestroyTexture(this->texture);
+}
 
+/**
+* decode - Load the file into a surface. Touches no renderer state, so it can run on a worker thread.
+*/
+void IVStaticImage::decode() {
 	SDL_Surface* surface = nullptr;
-	int filetype = IVUTIL::libSupport(path.extension().string());
+	if (!this->format) this->format = IVFORMAT::detect(this->path);
+	int filetype = this->format ? this->format->library : -1;
+
+	// every library reads straight from the page cache, and is done with the mapping by the end of decode(). Grid HEIF tile threads take it over
+	IVMappedFile input;
+	{
+		IVTRACE_SCOPE("open");
+		if (!input.open(this->path)) {
+			std::cout << IVUTIL::LOG_ERROR << "COULD NOT OPEN FILE" << std::endl;
+			throw IVUTIL::EXCEPT_IMG_OPEN_FAIL;
+		}
+		input.advise(IVMappedFile::ADVISE_SEQUENTIAL);
+	}
+
+	// formats libjpeg can scale while decoding
+	if (this->format && (this->format->capabilities & IVFORMAT::CAN_SCALE) && input.size) surface = decodeJPEG(input.data, input.size);
 
-	if (filetype == IVUTIL::TYPE_SDL) {
-		//load SDL image
-		surface = IMG_Load(path.string().c_str());
+	if (surface) {
+		//already decoded, and the size came from the file header
+		this->opaque = true;
+	}
+	else if (filetype == IVUTIL::TYPE_SDL) {
+		//load SDL image, its memory reader only takes int sizes
+		SDL_RWops* file = nullptr;
+		if (input.size && input.size <= INT32_MAX) file = SDL_RWFromConstMem(input.data, (int) input.size);
+		else if (input.size) file = SDL_RWFromFile(path.string().c_str(), "rb");
+		if (file) {
+			IVTRACE_SCOPE("read");
+			//the type is all SDL_image has to go on for TGA, which has no magic number. the rest it checks by content anyway
+			surface = IMG_LoadTyped_RW(file, 1, this->format->extensions[0]);
+		}
 
 		if (!surface) {
 			std::cout << IVUTIL::LOG_ERROR << "COULD NOT CREATE SURFACE" << std::endl;
 			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
 		}
+		this->opaque = covers(surface);
 	}
 	else if (filetype == IVUTIL::TYPE_LIBHEIF) {
 		//load HEIF image 
 		heif::Context ctx;
+		//libheif decodes the tiles of a grid in parallel itself, up to this many at once
+		ctx.set_max_decoding_threads(std::max(1u, std::thread::hardware_concurrency()));
 		try {
-			ctx.read_from_file(path.string());
+			IVTRACE_SCOPE("open");
+			ctx.read_from_memory_without_copy(input.data, input.size);
 		}
 		catch (...) {
 			std::cout << IVUTIL::LOG_ERROR << "LIBHEIF REPORTED IMAGE LOAD FAILURE" << std::endl;
@@ -34,66 +359,62 @@ IVStaticImage::IVStaticImage(SDL_Renderer* renderer, std::filesystem::path path)
 		}
 
 		heif::ImageHandle handle = ctx.get_primary_image_handle();
-		heif::Image img;
+
+		//grids that fit in one texture are decoded a tile at a time on every core, and appear as the tiles do.
+		//only for an image about to be shown, anything else is decoded whole. they're copied straight into the texture, so not when there isn't going to be one
+		if (this->progressive && !keep_pixels && (this->format->capabilities & IVFORMAT::CAN_TILE)) {
+			IVHeifTiles* grid = new IVHeifTiles();
+			grid->format = texture_format;
+			grid->arrived = notify;
+			if (grid->open(handle) && grid->w <= std::min(texture_max_w, TILE_THRESHOLD) && grid->h <= std::min(texture_max_h, TILE_THRESHOLD) && grid->start(input)) {
+				this->w = grid->w;
+				this->h = grid->h;
+				this->tiles = grid;
+				return;
+			}
+			delete grid;
+		}
+
+		this->opaque = !handle.has_alpha_channel();
 
 		try {
-			//load as R, G and B planes
-			img = handle.decode_image(heif_colorspace_RGB, heif_chroma_interleaved_RGB);
+			IVTRACE_SCOPE("read");
+			//let libheif produce interleaved RGBA directly so the plane can be used as is
+			this->heif_pixels = handle.decode_image(heif_colorspace_RGB, heif_chroma_interleaved_RGBA);
 		}
 		catch (...) {
 			std::cout << IVUTIL::LOG_ERROR << "LIBHEIF REPORTED IMAGE DECODE FAILURE" << std::endl;
 			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
 		}
 
-		if (img.has_channel(heif_channel_interleaved)) { //interleave mode
+		if (this->heif_pixels.has_channel(heif_channel_interleaved) && this->heif_pixels.get_bits_per_pixel(heif_channel_interleaved) == 32) { //interleave mode
 
-			int im_w = img.get_width(heif_channel_interleaved);
-			int im_h = img.get_height(heif_channel_interleaved);
-			int im_d = img.get_bits_per_pixel(heif_channel_interleaved); //depth (BPP)
+			int im_w = this->heif_pixels.get_width(heif_channel_interleaved);
+			int im_h = this->heif_pixels.get_height(heif_channel_interleaved);
 			int im_p; //libheif calls this 'stride', SDL calls it 'pitch'
 
-			uint8_t* RGB = img.get_plane(heif_channel_interleaved, &im_p); //pointer to pixel data
+			uint8_t* RGBA = this->heif_pixels.get_plane(heif_channel_interleaved, &im_p); //pointer to pixel data
 
-			surface = SDL_CreateRGBSurfaceWithFormat(0,
-				im_w, 
-				im_h, 
+			//wrap the plane without copying, heif_pixels keeps it alive until the surface is released
+			surface = SDL_CreateRGBSurfaceWithFormatFrom(RGBA,
+				im_w,
+				im_h,
 				32,
+				im_p,
 				SDL_PIXELFORMAT_RGBA32);
 
 			if (!surface) {
 				std::cout << IVUTIL::LOG_ERROR << "COULD NOT ALLOCATE SURFACE" << std::endl;
 				throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
 			}
-
-			//constant offset from difference between line size and image width
-			int const_offset = im_p - (im_w * (im_d / 8));
-
-			int i, offset = 0;
-
-			for (int y = 0; y < im_h; y++) {
-				for (int x = 0; x < im_w; x++) {
-
-					//determine pixel coordinates
-					i = y * im_w + x;
-
-					//assign new RGB values
-					((uint8_t *) surface->pixels)[i * 4 + 0] = RGB[i * 3 + 0 + offset];
-					((uint8_t *) surface->pixels)[i * 4 + 1] = RGB[i * 3 + 1 + offset];
-					((uint8_t *) surface->pixels)[i * 4 + 2] = RGB[i * 3 + 2 + offset];
-					((uint8_t *) surface->pixels)[i * 4 + 3] = 0xFF;
-				}
-
-				//increment line offset
-				offset += const_offset;
-			}
 		}
 		else {
 			std::cout << IVUTIL::LOG_ERROR << "UNSUPPORTED COLOUR FORMAT" << std::endl;
 			std::cout << "CHANNEL INDEX: ";
 			for (int i = 0; i < 7; i++) {
-				std::cout << (img.has_channel((heif_channel) i) ? '1' : '0');
+				std::cout << (this->heif_pixels.has_channel((heif_channel) i) ? '1' : '0');
 			}
-			std::cout << (img.has_channel((heif_channel) 10) ? '1' : '0') << std::endl;
+			std::cout << (this->heif_pixels.has_channel((heif_channel) 10) ? '1' : '0') << std::endl;
 			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
 		}
 	}
@@ -103,16 +424,253 @@ IVStaticImage::IVStaticImage(SDL_Renderer* renderer, std::filesystem::path path)
 		throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
 	}
 
-	this->animated = false;
+	if (this->scale == 1) {
+		this->w = surface->w;
+		this->h = surface->h;
+	}
+
+	// the one conversion an image gets, here on the worker rather than inside SDL on the main thread. Formats the
+	// renderer holds as they are (like the RGBA of a wrapped HEIF plane) go to the texture without it
+	uint32_t decoded = surface->format->format;
+	bool held = std::find(texture_formats.begin(), texture_formats.end(), decoded) != texture_formats.end();
+	if (decoded != texture_format && !held) {
+		IVTRACE_SCOPE("convert");
+		SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, texture_format, 0);
+		if (!converted) {
+			SDL_FreeSurface(surface);
+			std::cout << IVUTIL::LOG_ERROR << "COULD NOT CONVERT SURFACE" << std::endl;
+			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+		}
+		SDL_FreeSurface(surface);
+		surface = converted;
+		//the plane was copied out
+		this->heif_pixels = heif::Image();
+	}
+
+	// too big for one texture, split it into tiles
+	if (surface->w > std::min(texture_max_w, TILE_THRESHOLD) || surface->h > std::min(texture_max_h, TILE_THRESHOLD)) {
+		//a wrapped HEIF plane becomes the pyramid's full size level as it is, heif_pixels is kept for as long as the pyramid
+		this->pyramid = new IVTilePyramid(surface, this->opaque);
+	}
+	else {
+		this->surface = surface;
+		buildMips();
+	}
+}
+
+/**
+* decodePreview - Decode only the thumbnail a camera JPEG or HEIF file carries, which takes milliseconds. w and h are
+*				  set to the size of the real image, so the preview is drawn stretched to where it will be.
+* return - bool < False if the file has no usable thumbnail
+*/
+bool IVStaticImage::decodePreview() {
+	if (!this->format) this->format = IVFORMAT::detect(this->path);
+	if (!this->format || !(this->format->capabilities & IVFORMAT::HAS_THUMBNAIL)) return false;
+
+	IVMappedFile input;
+	if (!input.open(this->path) || !input.size) return false;
+
+	SDL_Surface* surface = nullptr;
+	int full_w = 0, full_h = 0;
+
+	if (this->format->type == IVUTIL::JPG) {
+		const uint8_t* thumbnail;
+		size_t length;
+		if (!findExifThumbnail(input.data, input.size, &thumbnail, &length, &full_w, &full_h)) return false;
+		this->reducible = false;
+		surface = decodeJPEG(thumbnail, length);
+		this->opaque = true;
+	}
+	else if (this->format->type == IVUTIL::HEIF) {
+		try {
+			heif::Context ctx;
+			ctx.read_from_memory_without_copy(input.data, input.size);
+			heif::ImageHandle handle = ctx.get_primary_image_handle();
+			if (handle.get_number_of_thumbnails() < 1) return false;
+			full_w = handle.get_width();
+			full_h = handle.get_height();
+			this->opaque = !handle.has_alpha_channel();
+
+			heif::ImageHandle thumbnail = handle.get_thumbnail(handle.get_list_of_thumbnail_IDs()[0]);
+			this->heif_pixels = thumbnail.decode_image(heif_colorspace_RGB, heif_chroma_interleaved_RGBA);
+		}
+		catch (...) {
+			return false;
+		}
+
+		int pitch;
+		uint8_t* RGBA = this->heif_pixels.get_plane(heif_channel_interleaved, &pitch);
+		if (RGBA) surface = SDL_CreateRGBSurfaceWithFormatFrom(RGBA, this->heif_pixels.get_width(heif_channel_interleaved), this->heif_pixels.get_height(heif_channel_interleaved), 32, pitch, SDL_PIXELFORMAT_RGBA32);
+	}
+
+	if (!surface || full_w <= 0 || full_h <= 0) {
+		SDL_FreeSurface(surface);
+		return false;
+	}
+
+	this->surface = cropToAspect(surface, full_w, full_h);
+	this->w = full_w;
+	this->h = full_h;
+	// scale stays 1 so nothing tries to upgrade a preview, the real decode is already on its way
+	this->scale = 1;
+	this->preview = true;
+	return true;
+}
+
+/**
+* upload	- Convert the decoded surface to a texture and release the CPU copy
+* renderer	> Target SDL_Renderer
+*/
+void IVStaticImage::upload(SDL_Renderer* renderer) {
 	this->renderer = renderer;
-	this->w = surface->w;
-	this->h = surface->h;
+	if (this->tiles) {
+		{
+			IVTRACE_SCOPE("texture");
+			this->texture = SDL_CreateTexture(renderer, texture_format, SDL_TEXTUREACCESS_STATIC, this->w, this->h);
+		}
+		if (!this->texture) {
+			std::cout << IVUTIL::LOG_ERROR << "COULD NOT CREATE TEXTURE" << std::endl;
+			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+		}
 
-	this->texture = SDL_CreateTextureFromSurface(renderer, surface);
+		//starts out transparent and fills in as the tiles arrive, a band of rows at a time keeps the blank buffer small
+		SDL_SetTextureBlendMode(this->texture, SDL_BLENDMODE_BLEND);
+		std::vector<uint32_t> blank((size_t) this->w * 64, 0);
+		for (int y = 0; y < this->h; y += 64) {
+			SDL_Rect band = {0, y, this->w, std::min(64, this->h - y)};
+			SDL_UpdateTexture(this->texture, &band, blank.data(), this->w * sizeof(uint32_t));
+		}
+		prepare();
+		return;
+	}
+	// tiles are uploaded as they come into view
+	if (!this->surface) return;
 
-	SDL_FreeSurface(surface);
+	// IVCompositor reads the surface and mips directly, so they stay and there's no texture. previews still need converting
+	if (keep_pixels) {
+		if (this->surface->format->format != texture_format) {
+			SDL_Surface* converted = SDL_ConvertSurfaceFormat(this->surface, texture_format, 0);
+			if (!converted) {
+				std::cout << IVUTIL::LOG_ERROR << "COULD NOT CONVERT SURFACE" << std::endl;
+				throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+			}
+			SDL_FreeSurface(this->surface);
+			this->surface = converted;
+			this->heif_pixels = heif::Image();
+		}
+		return;
+	}
+
+	//decoded in the texture's own format, so this is a straight copy
+	{
+		IVTRACE_SCOPE("texture");
+		this->texture = IVRENDER::createTexture(renderer, this->surface, SDL_TEXTUREACCESS_STREAMING);
+	}
+	//a surface with an unused alpha channel would otherwise be blended for nothing
+	SDL_BlendMode blend = this->opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND;
+	if (this->texture) SDL_SetTextureBlendMode(this->texture, blend);
+
+	uploadMips(blend);
+
+	SDL_FreeSurface(this->surface);
+	this->surface = nullptr;
+	this->heif_pixels = heif::Image();
+
+	if (!this->texture) {
+		std::cout << IVUTIL::LOG_ERROR << "COULD NOT CREATE TEXTURE" << std::endl;
+		throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+	}
 }
 
-IVStaticImage::~IVStaticImage() {
-	SDL_DestroyTexture(this->texture);
+/**
+* advance 		- Whether tiles of a grid HEIF have finished since the last prepare()
+* now 			> Current time, unused
+*/
+bool IVStaticImage::advance([[maybe_unused]] std::chrono::steady_clock::time_point now) {
+	return this->tiles && this->texture && this->tiles->ready();
+}
+
+/**
+* seek 			- Same as advance(), tiles that finished while the image was unseen are all copied in at once
+* now 			> Current time, unused
+*/
+bool IVStaticImage::seek(std::chrono::steady_clock::time_point now) {
+	return advance(now);
+}
+
+/**
+* arriving - Whether tiles of a grid HEIF are still decoding
+*/
+bool IVStaticImage::arriving() {
+	return this->tiles != nullptr;
+}
+
+/**
+* prepare - Copy newly decoded tiles into the texture. Once the last one is in, the decoder is released,
+*			mips are built from the assembled image and an image without alpha stops being blended.
+*/
+void IVStaticImage::prepare() {
+	if (!this->tiles || !this->texture) return;
+	this->tiles->upload(this->texture);
+	if (!this->tiles->done()) return;
+
+	this->opaque = !this->tiles->alpha;
+	SDL_BlendMode blend = this->opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND;
+	SDL_SetTextureBlendMode(this->texture, blend);
+	this->surface = this->tiles->take();
+	delete this->tiles;
+	this->tiles = nullptr;
+
+	if (!this->surface) return;
+	buildMips();
+	uploadMips(blend);
+	SDL_FreeSurface(this->surface);
+	this->surface = nullptr;
+}
+
+/**
+* draw 			- Draw the single texture (or its mip level nearest the size on screen), or only the visible tiles of a large image
+* destination 	> Where the whole image is placed in the window
+* viewport 		> Visible area of the window
+*/
+void IVStaticImage::draw(SDL_Rect* destination, SDL_Rect* viewport) {
+	if (this->pyramid) {
+		this->pyramid->draw(this->renderer, destination, viewport);
+		return;
+	}
+
+	// the smallest level still at least as large as it's drawn, so the GPU never shrinks anything by more than half
+	SDL_Texture* texture = this->texture;
+	for (auto& level : this->mips) {
+		if (!level.texture || level.w < destination->w || level.h < destination->h) break;
+		texture = level.texture;
+	}
+	IVRENDER::copyClipped(this->renderer, texture, destination, viewport);
+}
+
+/**
+* pixels 				- The decoded surface, or the smallest mip or pyramid level still at least w x h, for IVCompositor
+* w, h 					> Size the image is drawn at
+* return - SDL_Surface*	< Surface still owned by the image, nullptr unless keep_pixels was set when it was uploaded
+*/
+SDL_Surface* IVStaticImage::pixels(int w, int h) {
+	if (!keep_pixels) return nullptr;
+	if (this->pyramid) return this->pyramid->level(w, h);
+
+	SDL_Surface* surface = this->surface;
+	for (auto& level : this->mips) {
+		if (!level.surface || level.w < w || level.h < h) break;
+		surface = level.surface;
+	}
+	return surface;
+}
+
+/**
+* bytes - Memory held by the image, including every mip level of a tiled image
+*/
+size_t IVStaticImage::bytes() {
+	if (this->pyramid) return this->pyramid->bytes();
+	size_t total = (size_t) ((this->w + this->scale - 1) / this->scale) * ((this->h + this->scale - 1) / this->scale) * 4;
+	for (auto& level : this->mips) total += (size_t) level.w * level.h * 4;
+	return total;
 }
@@ -6,21 +6,96 @@ NICK WILSON
 
 #include <libheif/heif_cxx.h>
 
+#include <cstdio>		//FILE, needed before jpeglib
+#include <jpeglib.h>	//reduced JPEG decoding
+#include <atomic>		//target size
+#include <algorithm>	//find
+
 #include "IVUtil.hpp"	//utilities
+#include "IVTrace.hpp"	//timing
 #include "IVImage.hpp"	//base class
+#include "IVTilePyramid.hpp"	//large images
+#include "IVMappedFile.hpp"		//file input
+#include "IVHeifTiles.hpp"		//progressive HEIF
+#include "IVScale.hpp"			//mip levels
 
 #ifndef STATICIMAGE_H
 #define STATICIMAGE_H
 
+#define MIP_MIN 256		// halved copies stop once one fits in a square this many pixels across
+
 class IVStaticImage : public IVImage {
 private:
+	// decoded pixels waiting for upload(), or for good when keep_pixels is set
+	SDL_Surface* surface = nullptr;
+
+	// owns the pixels of surface, or of the pyramid's full size level, when it wraps a decoded HEIF plane
+	heif::Image heif_pixels;
+
+	// replaces surface and texture for images too large for a single texture
+	IVTilePyramid* pyramid = nullptr;
+
+	// halved copies of a single texture image, drawn instead of it when zoomed out. surface is only held until upload(), unless keep_pixels is set
+	struct mip {
+		SDL_Surface* surface;
+		SDL_Texture* texture;
+		int w, h;
+	};
+	std::vector<mip> mips;
+
+	// a grid HEIF still decoding in the background, its tiles are copied into texture as they finish and wake the main loop
+	IVHeifTiles* tiles = nullptr;
+
+	SDL_Surface* decodeJPEG(const uint8_t* data, size_t size);
+
+	static bool findExifThumbnail(const uint8_t* data, size_t size, const uint8_t** thumbnail, size_t* length, int* w, int* h);
+
+	static SDL_Surface* cropToAspect(SDL_Surface* surface, int w, int h);
+
+	static int reduction(int w, int h);
+
+	static bool covers(SDL_Surface* surface);
+
+	void buildMips();
+
+	void uploadMips(SDL_BlendMode blend);
 
 public:
+	// largest texture the renderer accepts, set once before any decoding starts
+	static int texture_max_w;
+	static int texture_max_h;
+
+	// area images are fitted to, kept up to date with the window. JPEGs are decoded at just enough resolution for it
+	static std::atomic<int> target_w;
+	static std::atomic<int> target_h;
+
 	IVStaticImage() {}
 
+	IVStaticImage(std::filesystem::path path);
+
 	IVStaticImage(SDL_Renderer* renderer, std::filesystem::path path);
 
 	~IVStaticImage();
+
+	void decode();
+
+	bool decodePreview();
+
+	void upload(SDL_Renderer* renderer);
+
+	bool advance(std::chrono::steady_clock::time_point now);
+
+	bool seek(std::chrono::steady_clock::time_point now);
+
+	bool arriving();
+
+	void prepare();
+
+	void draw(SDL_Rect* destination, SDL_Rect* viewport);
+
+	SDL_Surface* pixels(int w, int h);
+
+	size_t bytes();
 };
 
 #endif
@@ -0,0 +1,327 @@
+/*
+IVTHUMBNAILCACHE.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVThumbnailCache.hpp"
+
+#include <cstring>		//memcpy, memcmp
+
+#define THUMB_CACHE_VERSION 1
+
+/* records are padded so every one starts 8 byte aligned */
+static uint64_t padded(uint64_t length) {
+	return (length + 7) & ~(uint64_t) 7;
+}
+
+/* PRIVATE */
+
+/**
+* work - Worker loop, takes the most recently requested paths and finds or makes their thumbnails
+*/
+void IVThumbnailCache::work() {
+	while (true) {
+		std::filesystem::path path;
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->wake.wait(guard, [this] { return this->quit || !this->queue.empty(); });
+			if (this->quit) return;
+			path = this->queue.front();
+			this->queue.pop_front();
+			this->active.insert(path.string());
+		}
+
+		thumbnail t;
+		t.path = path;
+
+		// a file that can't be checked can still get a thumbnail, it just isn't kept
+		std::error_code error;
+		uint64_t bytes = std::filesystem::file_size(path, error);
+		int64_t modified = error ? 0 : std::filesystem::last_write_time(path, error).time_since_epoch().count();
+		uint64_t key = hash(path.string());
+
+		bool found = false;
+		if (!error) {
+			std::lock_guard<std::mutex> guard(this->lock);
+			found = load(&t, key, bytes, modified);
+		}
+		if (!found) {
+			make(&t);
+			if (t.w && !error) {
+				std::lock_guard<std::mutex> guard(this->lock);
+				store(&t, key, bytes, modified);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(this->lock);
+			this->active.erase(path.string());
+			this->done.push_back(std::move(t));
+		}
+
+		SDL_Event notify;
+		SDL_memset(&notify, 0, sizeof(notify));
+		notify.type = this->event_type;
+		SDL_PushEvent(&notify);
+	}
+}
+
+/**
+* load 			- Copy a stored thumbnail out of the cache file. Call with lock held.
+* t 			< Filled in if found
+* key 			> Hash of the path
+* bytes 		> Current file size
+* modified 		> Current modification time
+* return - bool	< False if there is no thumbnail for this version of the file
+*/
+bool IVThumbnailCache::load(thumbnail* t, uint64_t key, uint64_t bytes, int64_t modified) {
+	if (!this->persistent) return false;
+	auto found = this->index.find(key);
+	if (found == this->index.end()) return false;
+
+	record* r = (record*) (this->file.data + found->second);
+	if (r->bytes != bytes || r->modified != modified) return false;
+
+	t->w = r->w;
+	t->h = r->h;
+	t->pixels.assign(this->file.data + found->second + sizeof(record), this->file.data + found->second + sizeof(record) + r->length);
+	return true;
+}
+
+/**
+* store 	- Append a thumbnail to the cache file, growing it as needed. Call with lock held.
+* t 		> Thumbnail to store
+* key 		> Hash of the path
+* bytes 	> File size
+* modified 	> Modification time
+*/
+void IVThumbnailCache::store(thumbnail* t, uint64_t key, uint64_t bytes, int64_t modified) {
+	if (!this->persistent) return;
+	uint64_t used = ((header*) this->file.data)->used;
+	uint64_t need = sizeof(record) + padded(t->pixels.size());
+
+	if (used + need > this->file.size) {
+		size_t size = this->file.size;
+		while (used + need > size) size += THUMB_CACHE_GROW;
+
+		// full, start over rather than work out what to evict
+		if (size > THUMB_CACHE_LIMIT) {
+			reset();
+			used = ((header*) this->file.data)->used;
+		}
+		else if (!this->file.resize(size)) {
+			std::cerr << IVUTIL::LOG_WARNING << "Could not grow thumbnail cache, thumbnails will not be kept" << std::endl;
+			this->persistent = false;
+			this->index.clear();
+			return;
+		}
+	}
+
+	record* r = (record*) (this->file.data + used);
+	r->key = key;
+	r->bytes = bytes;
+	r->modified = modified;
+	r->w = t->w;
+	r->h = t->h;
+	r->length = t->pixels.size();
+	memcpy(this->file.data + used + sizeof(record), t->pixels.data(), t->pixels.size());
+
+	// only counted once it's all there
+	((header*) this->file.data)->used = used + need;
+	this->index[key] = used;
+}
+
+/**
+* reset - Empty the cache file. Call with lock held.
+*/
+void IVThumbnailCache::reset() {
+	header* h = (header*) this->file.data;
+	memcpy(h->magic, "IVTC", 4);
+	h->version = THUMB_CACHE_VERSION;
+	h->size = THUMB_SIZE;
+	h->reserved = 0;
+	h->used = sizeof(header);
+	this->index.clear();
+}
+
+/**
+* make 	- Decode an image and shrink it to a thumbnail. HEIF files use their embedded thumbnail when they have one.
+* t 	< Filled in, left with no size if the image couldn't be read
+*/
+void IVThumbnailCache::make(thumbnail* t) {
+	IVTRACE_SCOPE("thumbnail", t->path.string());
+	const IVFORMAT::format* format = IVFORMAT::detect(t->path);
+	IVMappedFile input;
+	if (!format || !input.open(t->path) || !input.size) return;
+	input.advise(IVMappedFile::ADVISE_SEQUENTIAL);
+
+	if (format->library == IVUTIL::TYPE_LIBHEIF) {
+		try {
+			heif::Context ctx;
+			ctx.read_from_memory_without_copy(input.data, input.size);
+			heif::ImageHandle handle = ctx.get_primary_image_handle();
+			if (handle.get_number_of_thumbnails() > 0) handle = handle.get_thumbnail(handle.get_list_of_thumbnail_IDs()[0]);
+
+			heif::Image image = handle.decode_image(heif_colorspace_RGB, heif_chroma_interleaved_RGBA);
+			int pitch;
+			const uint8_t* pixels = image.get_plane(heif_channel_interleaved, &pitch);
+			if (pixels) shrink(t, pixels, image.get_width(heif_channel_interleaved), image.get_height(heif_channel_interleaved), pitch);
+		}
+		catch (...) {
+			return;
+		}
+	}
+	else {
+		// SDL_image reads the first frame of a GIF as well
+		if (input.size > INT32_MAX) return;
+		// typed, as TGA can't be told apart by content
+		SDL_Surface* loaded = IMG_LoadTyped_RW(SDL_RWFromConstMem(input.data, (int) input.size), 1, format->extensions[0]);
+		if (!loaded) return;
+		SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(loaded);
+		if (!surface) return;
+
+		SDL_LockSurface(surface);
+		shrink(t, (const uint8_t*) surface->pixels, surface->w, surface->h, surface->pitch);
+		SDL_UnlockSurface(surface);
+		SDL_FreeSurface(surface);
+	}
+}
+
+/**
+* shrink 	- Area average RGBA pixels down to fit THUMB_SIZE, keeping the aspect ratio
+* t 		< Receives the size and pixels
+* pixels 	> Source RGBA32 pixels
+* w 		> Source width
+* h 		> Source height
+* pitch 	> Source bytes per row
+*/
+void IVThumbnailCache::shrink(thumbnail* t, const uint8_t* pixels, int w, int h, int pitch) {
+	if (w <= 0 || h <= 0) return;
+	if (w >= h) {
+		t->w = std::min(w, THUMB_SIZE);
+		t->h = std::max(1, (int) ((int64_t) h * t->w / w));
+	}
+	else {
+		t->h = std::min(h, THUMB_SIZE);
+		t->w = std::max(1, (int) ((int64_t) w * t->h / h));
+	}
+	t->pixels.resize((size_t) t->w * t->h * 4);
+
+	for (int y = 0; y < t->h; y++) {
+		int y0 = (int) ((int64_t) y * h / t->h);
+		int y1 = std::max(y0 + 1, (int) ((int64_t) (y + 1) * h / t->h));
+		for (int x = 0; x < t->w; x++) {
+			int x0 = (int) ((int64_t) x * w / t->w);
+			int x1 = std::max(x0 + 1, (int) ((int64_t) (x + 1) * w / t->w));
+
+			uint64_t sum[4] = {0, 0, 0, 0};
+			for (int sy = y0; sy < y1; sy++) {
+				const uint8_t* row = pixels + (size_t) sy * pitch + (size_t) x0 * 4;
+				for (int sx = x0; sx < x1; sx++, row += 4) {
+					sum[0] += row[0];
+					sum[1] += row[1];
+					sum[2] += row[2];
+					sum[3] += row[3];
+				}
+			}
+
+			uint64_t count = (uint64_t) (x1 - x0) * (y1 - y0);
+			uint8_t* out = t->pixels.data() + ((size_t) y * t->w + x) * 4;
+			for (int c = 0; c < 4; c++) out[c] = (uint8_t) (sum[c] / count);
+		}
+	}
+}
+
+/**
+* hash - FNV-1a, enough to tell paths apart with size and time as a check
+*/
+uint64_t IVThumbnailCache::hash(const std::string& s) {
+	uint64_t h = 0xCBF29CE484222325ull;
+	for (unsigned char c : s) {
+		h ^= c;
+		h *= 0x100000001B3ull;
+	}
+	return h;
+}
+
+/* PUBLIC */
+
+/**
+* IVThumbnailCache	- Open the cache file and start the workers
+* path 				> Cache file, created if missing. If another instance has it open, thumbnails are made but not kept.
+* event_type 		> SDL event type pushed whenever a thumbnail is ready to collect
+*/
+IVThumbnailCache::IVThumbnailCache(std::filesystem::path path, uint32_t event_type) {
+	this->event_type = event_type;
+
+	std::error_code error;
+	size_t existing = std::filesystem::file_size(path, error);
+	if (error) existing = 0;
+
+	this->persistent = this->file.create(path, std::max(existing, (size_t) THUMB_CACHE_GROW));
+	if (!this->persistent) {
+		std::cerr << IVUTIL::LOG_NOTICE << "Thumbnail cache in use or unavailable, thumbnails will not be kept" << std::endl;
+	}
+	else {
+		// find the newest record for every path, stopping at anything that doesn't add up
+		header* h = (header*) this->file.data;
+		if (memcmp(h->magic, "IVTC", 4) || h->version != THUMB_CACHE_VERSION || h->size != THUMB_SIZE || h->used < sizeof(header) || h->used > this->file.size) {
+			reset();
+		}
+
+		uint64_t offset = sizeof(header);
+		while (offset + sizeof(record) <= h->used) {
+			record* r = (record*) (this->file.data + offset);
+			if (!r->w || !r->h || r->w > THUMB_SIZE || r->h > THUMB_SIZE || r->length != (uint32_t) r->w * r->h * 4) break;
+			uint64_t next = offset + sizeof(record) + padded(r->length);
+			if (next > h->used) break;
+
+			this->index[r->key] = offset;
+			offset = next;
+		}
+		h->used = offset;
+		this->file.advise(IVMappedFile::ADVISE_RANDOM);
+	}
+
+	for (int i = 0; i < THUMB_THREADS; i++) {
+		this->workers.emplace_back(&IVThumbnailCache::work, this);
+	}
+}
+
+IVThumbnailCache::~IVThumbnailCache() {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->quit = true;
+		this->queue.clear();
+	}
+	this->wake.notify_all();
+	for (auto& worker : this->workers) worker.join();
+}
+
+/**
+* request 	- Ask for thumbnails, replacing anything still queued from before. Nearest first.
+* paths 	> Images to make or find thumbnails for
+*/
+void IVThumbnailCache::request(const std::vector<std::filesystem::path>& paths) {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->queue.clear();
+		for (auto& path : paths) {
+			if (!this->active.count(path.string())) this->queue.push_back(path);
+		}
+	}
+	this->wake.notify_all();
+}
+
+/**
+* collect 			- Take finished thumbnails. Call from the main thread.
+* return - vector	< Thumbnails ready since the last call
+*/
+std::vector<IVThumbnailCache::thumbnail> IVThumbnailCache::collect() {
+	std::lock_guard<std::mutex> guard(this->lock);
+	std::vector<thumbnail> taken;
+	taken.swap(this->done);
+	return taken;
+}
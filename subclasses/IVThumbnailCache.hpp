@@ -0,0 +1,100 @@
+/*
+IVTHUMBNAILCACHE.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <libheif/heif_cxx.h>
+
+#include <cstdint>			//standard number formats
+#include <string>			//string type
+#include <filesystem>		//fs path
+#include <vector>			//pixel buffers
+#include <deque>			//request queue
+#include <unordered_map>	//record index
+#include <unordered_set>	//requests in progress
+#include <thread>			//workers
+#include <mutex>			//queue and file lock
+#include <condition_variable>	//worker wakeup
+
+#include "IVUtil.hpp"			//utilities
+#include "IVFormat.hpp"			//format registry
+#include "IVMappedFile.hpp"		//cache file
+#include "IVTrace.hpp"			//timing
+
+#ifndef IVTHUMBNAILCACHE_H
+#define IVTHUMBNAILCACHE_H
+
+#define THUMB_SIZE 96					// thumbnails fit in a square this many pixels across
+#define THUMB_THREADS 2					// background thumbnail workers
+#define THUMB_CACHE_GROW (16 << 20)		// the cache file grows in steps this size
+#define THUMB_CACHE_LIMIT (256 << 20)	// and starts over once it would pass this
+
+/* Small previews of images, made by background workers and kept in one memory mapped file between runs.
+   Entries are keyed by path, size and modification time, so a changed file gets a new thumbnail. */
+class IVThumbnailCache {
+public:
+	struct thumbnail {
+		std::filesystem::path path;
+		int w = 0, h = 0;				// 0 if the image couldn't be read
+		std::vector<uint8_t> pixels;	// RGBA32, w * h * 4 bytes
+	};
+
+private:
+	struct header {
+		char magic[4];
+		uint32_t version;
+		uint32_t size;		// THUMB_SIZE the file was made with
+		uint32_t reserved;
+		uint64_t used;		// bytes holding complete records, written last so a torn record is ignored
+	};
+
+	struct record {
+		uint64_t key;		// hash of the path
+		uint64_t bytes;		// file size
+		int64_t modified;	// file modification time
+		uint16_t w, h;
+		uint32_t length;	// pixel bytes following, before padding
+	};
+
+	IVMappedFile file;
+	bool persistent = false;					// false if the file couldn't be used, thumbnails are still made
+	std::unordered_map<uint64_t, uint64_t> index;	// key -> offset of the newest record
+
+	std::vector<std::thread> workers;
+	std::mutex lock;							// guards everything below and the file
+	std::condition_variable wake;
+	std::deque<std::filesystem::path> queue;
+	std::unordered_set<std::string> active;
+	std::vector<thumbnail> done;
+	bool quit = false;
+
+	uint32_t event_type;
+
+	void work();
+
+	bool load(thumbnail* t, uint64_t key, uint64_t bytes, int64_t modified);
+
+	void store(thumbnail* t, uint64_t key, uint64_t bytes, int64_t modified);
+
+	void reset();
+
+	static void make(thumbnail* t);
+
+	static void shrink(thumbnail* t, const uint8_t* pixels, int w, int h, int pitch);
+
+	static uint64_t hash(const std::string& s);
+
+public:
+	IVThumbnailCache(std::filesystem::path path, uint32_t event_type);
+
+	~IVThumbnailCache();
+
+	void request(const std::vector<std::filesystem::path>& paths);
+
+	std::vector<thumbnail> collect();
+};
+
+#endif
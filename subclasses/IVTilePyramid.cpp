@@ -0,0 +1,182 @@
+/*
+IVTILEPYRAMID.CPP
+NICK WILSON
+2020
+*/
+
+#include "IVTilePyramid.hpp"
+#include "IVRender.hpp"
+
+/* PRIVATE */
+
+/**
+* key 			- Pack a tile position into a single lookup key
+* level 		> Mip level
+* tx, ty 		> Tile column and row
+*/
+uint64_t IVTilePyramid::key(int level, int tx, int ty) {
+	return ((uint64_t) level << 48) | ((uint64_t) (uint32_t) ty << 24) | (uint32_t) tx;
+}
+
+/**
+* fetch 		- Return the texture for a tile, uploading it from the level surface if it isn't resident
+* renderer 		> Target SDL_Renderer
+* level 		> Mip level
+* tx, ty 		> Tile column and row
+*/
+SDL_Texture* IVTilePyramid::fetch(SDL_Renderer* renderer, int level, int tx, int ty) {
+	auto found = this->tiles.find(key(level, tx, ty));
+	if (found != this->tiles.end()) {
+		found->second.used = this->frame;
+		return found->second.texture;
+	}
+
+	SDL_Surface* source = this->levels[level];
+	int tw = std::min(TILE_SIZE, source->w - tx * TILE_SIZE);
+	int th = std::min(TILE_SIZE, source->h - ty * TILE_SIZE);
+
+	SDL_Texture* texture = SDL_CreateTexture(renderer, source->format->format, SDL_TEXTUREACCESS_STATIC, tw, th);
+	if (!texture) return nullptr;
+
+	uint8_t* pixels = (uint8_t*) source->pixels + (size_t) ty * TILE_SIZE * source->pitch + (size_t) tx * TILE_SIZE * 4;
+	SDL_UpdateTexture(texture, nullptr, pixels, source->pitch);
+	SDL_SetTextureBlendMode(texture, this->opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+
+	this->tiles[key(level, tx, ty)] = {texture, this->frame};
+	return texture;
+}
+
+/**
+* pick 			- The smallest level that still has at least one pixel per screen pixel
+* w, h 			> Size the image is drawn at
+* return - int 	< Level index
+*/
+int IVTilePyramid::pick(int w, int h) {
+	int level = 0;
+	while (level + 1 < (int) this->levels.size() && this->levels[level + 1]->w >= w && this->levels[level + 1]->h >= h) {
+		level++;
+	}
+	return level;
+}
+
+/**
+* trim - Release the least recently drawn tiles until the resident count is back under TILE_LIMIT.
+*		 Tiles drawn this frame are never released.
+*/
+void IVTilePyramid::trim() {
+	while (this->tiles.size() > TILE_LIMIT) {
+		auto oldest = this->tiles.begin();
+		for (auto it = this->tiles.begin(); it != this->tiles.end(); it++) {
+			if (it->second.used < oldest->second.used) oldest = it;
+		}
+		if (oldest->second.used == this->frame) return;
+
+		SDL_DestroyTexture(oldest->second.texture);
+		this->tiles.erase(oldest);
+	}
+}
+
+/* PUBLIC */
+
+/**
+* IVTilePyramid	- Build mip levels for a large image. Only touches CPU memory, so it can run on a worker thread.
+* surface 		> Decoded image, ownership is taken. Pixels it wraps rather than owns must outlive the pyramid. Throws IVUTIL::EXCEPT_IMG_LOAD_FAIL if it can't be converted
+* opaque 		> The image has no transparent pixels, so tiles can be drawn without blending
+*/
+IVTilePyramid::IVTilePyramid(SDL_Surface* surface, bool opaque) {
+	IVTRACE_SCOPE("convert");
+	this->opaque = opaque;
+	this->w = surface->w;
+	this->h = surface->h;
+
+	// any 32 BPP layout keeps tile upload and downsampling simple, decoders normally hand over the renderer's own
+	SDL_Surface* level = surface;
+	if (surface->format->BytesPerPixel != 4) {
+		level = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+		SDL_FreeSurface(surface);
+		if (!level) {
+			std::cout << IVUTIL::LOG_ERROR << "COULD NOT CONVERT SURFACE" << std::endl;
+			throw IVUTIL::EXCEPT_IMG_LOAD_FAIL;
+		}
+	}
+	this->levels.push_back(level);
+
+	// halve with a 2x2 area average until the whole level fits in a single tile
+	while (level->w > TILE_SIZE || level->h > TILE_SIZE) {
+		SDL_Surface* next = IVSCALE::halve(level);
+		if (!next) break;
+
+		this->levels.push_back(next);
+		level = next;
+	}
+}
+
+IVTilePyramid::~IVTilePyramid() {
+	for (auto& resident : this->tiles) SDL_DestroyTexture(resident.second.texture);
+	for (auto level : this->levels) SDL_FreeSurface(level);
+}
+
+/**
+* draw 			- Draw the tiles of the most suitable level that fall inside the viewport, uploading them as needed
+* renderer 		> Target SDL_Renderer
+* destination 	> Where the whole image would be drawn, may extend well past the viewport
+* viewport 		> Visible area of the window
+*/
+void IVTilePyramid::draw(SDL_Renderer* renderer, SDL_Rect* destination, SDL_Rect* viewport) {
+	if (this->levels.empty() || destination->w <= 0 || destination->h <= 0) return;
+	this->frame++;
+
+	int level = pick(destination->w, destination->h);
+	SDL_Surface* source = this->levels[level];
+
+	int columns = (source->w + TILE_SIZE - 1) / TILE_SIZE;
+	int rows = (source->h + TILE_SIZE - 1) / TILE_SIZE;
+
+	// range of tiles touching the viewport
+	auto first = [](int view, int dest, int extent, int size) -> int {
+		return (int) std::floor((view - dest) * (double) size / extent / TILE_SIZE);
+	};
+	int tx0 = std::max(0, first(viewport->x, destination->x, destination->w, source->w));
+	int ty0 = std::max(0, first(viewport->y, destination->y, destination->h, source->h));
+	int tx1 = std::min(columns - 1, first(viewport->x + viewport->w, destination->x, destination->w, source->w));
+	int ty1 = std::min(rows - 1, first(viewport->y + viewport->h, destination->y, destination->h, source->h));
+
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			SDL_Texture* texture = fetch(renderer, level, tx, ty);
+			if (!texture) continue;
+
+			// compute both edges from the level grid so neighbouring tiles meet without gaps
+			int sx0 = tx * TILE_SIZE, sx1 = std::min(source->w, sx0 + TILE_SIZE);
+			int sy0 = ty * TILE_SIZE, sy1 = std::min(source->h, sy0 + TILE_SIZE);
+			int dx0 = destination->x + (int) ((int64_t) sx0 * destination->w / source->w);
+			int dx1 = destination->x + (int) ((int64_t) sx1 * destination->w / source->w);
+			int dy0 = destination->y + (int) ((int64_t) sy0 * destination->h / source->h);
+			int dy1 = destination->y + (int) ((int64_t) sy1 * destination->h / source->h);
+
+			SDL_Rect tileDestination = {dx0, dy0, dx1 - dx0, dy1 - dy0};
+			IVRENDER::copyClipped(renderer, texture, &tileDestination, viewport);
+		}
+	}
+
+	trim();
+}
+
+/**
+* level 				- The level draw() would use at a size, for drawing from the CPU copy instead of tiles
+* w, h 					> Size the image is drawn at
+* return - SDL_Surface*	< Level surface, still owned by the pyramid
+*/
+SDL_Surface* IVTilePyramid::level(int w, int h) {
+	if (this->levels.empty()) return nullptr;
+	return this->levels[pick(w, h)];
+}
+
+/**
+* bytes - Memory held by the levels and resident tiles
+*/
+size_t IVTilePyramid::bytes() {
+	size_t total = this->tiles.size() * TILE_SIZE * TILE_SIZE * 4;
+	for (auto level : this->levels) total += (size_t) level->pitch * level->h;
+	return total;
+}
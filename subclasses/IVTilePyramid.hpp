@@ -0,0 +1,63 @@
+/*
+IVTILEPYRAMID.HPP
+NICK WILSON
+2020
+*/
+
+#include <SDL2/SDL.h>
+
+#include <cstdint>			//standard number formats
+#include <cmath>			//floor
+#include <algorithm>		//min, max
+#include <vector>			//mip levels
+#include <unordered_map>	//resident tiles
+
+#include "IVUtil.hpp"		//utilities
+#include "IVTrace.hpp"		//timing
+#include "IVScale.hpp"		//mip levels
+
+#ifndef IVTILEPYRAMID_H
+#define IVTILEPYRAMID_H
+
+#define TILE_SIZE 512		// edge length of a tile texture in pixels
+#define TILE_LIMIT 160		// tile textures kept resident, about 160 MB at 32 BPP
+#define TILE_THRESHOLD 8192	// images wider or taller than this are always tiled
+
+class IVTilePyramid {
+private:
+	struct tile {
+		SDL_Texture* texture;
+		uint64_t used;		// frame the tile was last drawn in
+	};
+
+	// level 0 is full resolution, each level after is half the size of the last
+	std::vector<SDL_Surface*> levels;
+	std::unordered_map<uint64_t, tile> tiles;
+	uint64_t frame = 0;
+	bool opaque = false;
+
+	static uint64_t key(int level, int tx, int ty);
+
+	SDL_Texture* fetch(SDL_Renderer* renderer, int level, int tx, int ty);
+
+	int pick(int w, int h);
+
+	void trim();
+
+public:
+	int w, h;
+
+	IVTilePyramid() {}
+
+	IVTilePyramid(SDL_Surface* surface, bool opaque);
+
+	~IVTilePyramid();
+
+	void draw(SDL_Renderer* renderer, SDL_Rect* destination, SDL_Rect* viewport);
+
+	SDL_Surface* level(int w, int h);
+
+	size_t bytes();
+};
+
+#endif
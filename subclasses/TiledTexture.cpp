@@ -9,28 +9,59 @@ NICK WILSON
 /* PUBLIC */
 
 TiledTexture::TiledTexture(SDL_Renderer* renderer, int w, int h, uint32_t HIGH, uint32_t LOW) {
-	SDL_Surface* surface = SDL_CreateRGBSurface(0, w, h, 32, 0, 0, 0, 0);
-
+	this->renderer = renderer;
 	this->w = w;
 	this->h = h;
 	this->HIGH = HIGH;
 	this->LOW = LOW;
+}
+
+/**
+* layer 				- The checkerboard covering a whole window, made again only if the size has changed
+* width 				> Window width
+* height 				> Window height
+* return - SDL_Texture*	< Texture of exactly width x height, nullptr if it couldn't be created
+*/
+SDL_Texture* TiledTexture::layer(int width, int height) {
+	if (this->texture && this->layer_w == width && this->layer_h == height) return this->texture;
+	release();
+	if (width <= 0 || height <= 0) return nullptr;
+
+	this->texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STATIC, width, height);
+	if (!this->texture) return nullptr;
+	this->layer_w = width;
+	this->layer_h = height;
 
-	for (int lh = 0; lh < h; lh++) {
-		for (int lw = 0; lw < w; lw++) {
-			if ((lh < (h/2)) ^ (lw < (w/2))) {
-				*((uint32_t *) surface->pixels + (lh * w + lw)) = HIGH;
+	// every row of tiles is the same, so build one and upload it down the window
+	std::vector<uint32_t> band((size_t) width * this->h);
+	for (int lh = 0; lh < this->h; lh++) {
+		for (int lw = 0; lw < width; lw++) {
+			if ((lh < (this->h/2)) ^ ((lw % this->w) < (this->w/2))) {
+				band[(size_t) lh * width + lw] = HIGH;
 			}
 			else {
-				*((uint32_t *) surface->pixels + (lh * w + lw)) = LOW;
+				band[(size_t) lh * width + lw] = LOW;
 			}
 		}
 	}
 
-	texture = SDL_CreateTextureFromSurface(renderer, surface);
-	SDL_FreeSurface(surface);
+	for (int y = 0; y < height; y += this->h) {
+		SDL_Rect area = {0, y, width, std::min(this->h, height - y)};
+		SDL_UpdateTexture(this->texture, &area, band.data(), width * sizeof(uint32_t));
+	}
+
+	return this->texture;
+}
+
+/**
+* release - Free the layer, for when the other theme is in use
+*/
+void TiledTexture::release() {
+	SDL_DestroyTexture(this->texture);
+	this->texture = nullptr;
+	this->layer_w = this->layer_h = 0;
 }
 
 TiledTexture::~TiledTexture() {
-	SDL_DestroyTexture(texture);
+	release();
 }
@@ -8,13 +8,20 @@ NICK WILSON
 
 #include <cstdint>		//standard number formats
 #include <string>		//string type
+#include <algorithm>	//std::min
+#include <vector>		//pattern rows
 
 #ifndef TILEDTEXTUREOBJ_H
 #define TILEDTEXTUREOBJ_H
 
+/* Checkerboard background. The whole window's worth is rendered into one texture, which is only remade when the window size changes */
 class TiledTexture {
 
 private:
+	SDL_Renderer* renderer = nullptr;
+
+	// window-sized layer, the size it was made for
+	int layer_w = 0, layer_h = 0;
 
 public:
 	int w, h;
@@ -26,6 +33,10 @@ public:
 
 	TiledTexture(SDL_Renderer* renderer, int w, int h, uint32_t HIGH, uint32_t LOW);
 
+	SDL_Texture* layer(int width, int height);
+
+	void release();
+
 	~TiledTexture();
 };
 
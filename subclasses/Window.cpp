@@ -30,6 +30,8 @@ Window::Window(int w, int h, int x, int y, uint32_t flags) {
 	if (!SDL_GetRenderer(window)) {
 		/* Framerate matching handled in main loop now, so vsync is disabled */
 		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED /*| SDL_RENDERER_PRESENTVSYNC*/);
+		/* SDL skips drivers without every requested flag, so without a GPU the software one has to be asked for */
+		if (!renderer) renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
 	}
 	else {
 		renderer = SDL_GetRenderer(window);